@@ -0,0 +1,214 @@
+/*
+ *  anniversary.c
+ *  Yahrzeits and Hebrew birthdays in bulk, and an index of them by date.
+ */
+
+#include <stdlib.h>
+#include "anniversary.h"
+
+#pragma mark Rules
+
+/* What an anniversary is in any year, once its own year is accounted for. */
+enum Rule {
+    RULE_MONTH,         /* day of month */
+    RULE_LAST_MONTH,    /* day of Adar, or Adar II in a leap year */
+    RULE_DAY_BEFORE,    /* the day before the first of month */
+    RULE_ADAR_30,       /* 30 Adar, or 30 Shevat in a common year */
+    RULE_SCALAR         /* a month out of range; left to the scalar function */
+};
+
+struct Plan {
+    enum Rule rule;
+    int month;
+    int day;
+};
+
+/* The first of each month of a year by month number, as fixed_from_hebrew
+   gives them: first[13] of a common year is Nisan, as there. */
+struct Year {
+    int year;
+    bool leap;
+    int first[14];
+};
+
+static void year_months(int year, struct Year *y)
+{
+    struct HebrewYearInfo info;
+    hebrew_year_info(year, &info);
+    y->year = year;
+    y->leap = info.months == 13;
+    for (int i = 0; i < info.months; i++)
+        y->first[i < info.months - 6 ? i + 7 : i - info.months + 7] = info.month_start[i];
+    if (!y->leap) y->first[13] = y->first[1];
+}
+
+static int apply(const struct Plan *p, const struct Year *y)
+{
+    switch (p->rule) {
+        case RULE_MONTH: return y->first[p->month] + p->day - 1;
+        case RULE_LAST_MONTH: return y->first[y->leap ? 13 : 12] + p->day - 1;
+        case RULE_DAY_BEFORE: return y->first[p->month] - 1;
+        case RULE_ADAR_30: return y->first[y->leap ? 12 : 11] + 29;
+        default: return 0;
+    }
+}
+
+/* The year after a death decides 30 Heshvan and 30 Kislev. Records come
+   in runs from the same years often enough to keep the last one. */
+struct YearLength {
+    int year;
+    int days;           /* 0 until worked out */
+};
+
+static int year_length(struct YearLength *cache, int year)
+{
+    if (cache->days == 0 || cache->year != year) {
+        cache->year = year;
+        cache->days = days_in_hebrew_year(year);
+    }
+    return cache->days;
+}
+
+static struct Plan yahrzeit_plan(const struct HebrewRecord *r, struct YearLength *cache)
+{
+    struct Plan p = { RULE_MONTH, r->month, r->day };
+    if (r->month == 8 && r->day == 30) {
+        int days = year_length(cache, r->year + 1);
+        if (days != 355 && days != 385) return (struct Plan){ RULE_DAY_BEFORE, 9, 0 };
+    }
+    if (r->month == 9 && r->day == 30) {
+        int days = year_length(cache, r->year + 1);
+        if (days != 353 && days != 383) return (struct Plan){ RULE_DAY_BEFORE, 10, 0 };
+    }
+    if (r->month == 13) p.rule = RULE_LAST_MONTH;
+    else if (r->month == 12 && r->day == 30) p.rule = RULE_ADAR_30;
+    else if (r->month < 1 || r->month > 13) p.rule = RULE_SCALAR;
+    return p;
+}
+
+static struct Plan birthday_plan(const struct HebrewRecord *r)
+{
+    struct Plan p = { RULE_MONTH, r->month, r->day };
+    if (r->month == last_month_of_hebrew_year(r->year)) p.rule = RULE_LAST_MONTH;
+    else if (r->month < 1 || r->month > 13) p.rule = RULE_SCALAR;
+    return p;
+}
+
+#pragma mark Batches
+
+/* Plans in blocks, so that they stay in cache across the years. */
+#define BLOCK 4096
+
+void yahrzeit_n(const struct HebrewRecord *restrict deaths, size_t count,
+                int first_year, int years, int *restrict dates)
+{
+    struct Plan plans[BLOCK];
+    struct Year *y = malloc(years > 0 ? years * sizeof *y : 1);
+    struct YearLength cache = { 0, 0 };
+
+    for (int j = 0; j < years && y; j++) year_months(first_year + j, &y[j]);
+    for (size_t base = 0; base < count; base += BLOCK) {
+        size_t n = count - base < BLOCK ? count - base : BLOCK;
+        for (size_t i = 0; i < n; i++) plans[i] = yahrzeit_plan(&deaths[base + i], &cache);
+        for (int j = 0; j < years; j++) {
+            int *column = dates + (size_t)j * count + base;
+            for (size_t i = 0; i < n; i++) {
+                const struct HebrewRecord *r = &deaths[base + i];
+                column[i] = y && plans[i].rule != RULE_SCALAR ? apply(&plans[i], &y[j]) :
+                    yahrzeit(r->month, r->day, r->year, first_year + j);
+            }
+        }
+    }
+    free(y);
+}
+
+void hebrew_birthday_n(const struct HebrewRecord *restrict births, size_t count,
+                       int first_year, int years, int *restrict dates)
+{
+    struct Plan plans[BLOCK];
+    struct Year *y = malloc(years > 0 ? years * sizeof *y : 1);
+
+    for (int j = 0; j < years && y; j++) year_months(first_year + j, &y[j]);
+    for (size_t base = 0; base < count; base += BLOCK) {
+        size_t n = count - base < BLOCK ? count - base : BLOCK;
+        for (size_t i = 0; i < n; i++) plans[i] = birthday_plan(&births[base + i]);
+        for (int j = 0; j < years; j++) {
+            int *column = dates + (size_t)j * count + base;
+            for (size_t i = 0; i < n; i++) {
+                const struct HebrewRecord *r = &births[base + i];
+                column[i] = y && plans[i].rule != RULE_SCALAR ? apply(&plans[i], &y[j]) :
+                    hebrew_birthday(r->month, r->day, r->year, first_year + j);
+            }
+        }
+    }
+    free(y);
+}
+
+#pragma mark Index
+
+/* A counting sort by date: the dates of a few decades span some
+   thousands of days, however many records there are. */
+struct AnniversaryIndex *anniversary_index_create(const int *dates, size_t count,
+                                                  int years)
+{
+    size_t total = years > 0 ? count * years : 0;
+    if (total >= UINT32_MAX) return NULL;
+
+    struct AnniversaryIndex *index = malloc(sizeof *index);
+    if (!index) return NULL;
+    int first = 0, last = -1;
+    for (size_t k = 0; k < total; k++) {
+        if (k == 0 || dates[k] < first) first = dates[k];
+        if (k == 0 || dates[k] > last) last = dates[k];
+    }
+    index->first = first;
+    index->days = last - first + 1;
+    index->start = calloc(index->days + 1, sizeof *index->start);
+    index->record = malloc((total ? total : 1) * sizeof *index->record);
+    if (!index->start || !index->record) {
+        anniversary_index_destroy(index);
+        return NULL;
+    }
+
+    for (size_t k = 0; k < total; k++) index->start[dates[k] - first + 1]++;
+    for (int d = 0; d < index->days; d++) index->start[d + 1] += index->start[d];
+    /* start[d] is where date d's records go; filling moves it on to
+       date d + 1's, so shift back afterwards. */
+    for (size_t k = 0; k < total; k++)
+        index->record[index->start[dates[k] - first]++] = (uint32_t)(k % count);
+    for (int d = index->days; d > 0; d--) index->start[d] = index->start[d - 1];
+    index->start[0] = 0;
+    return index;
+}
+
+void anniversary_index_destroy(struct AnniversaryIndex *index)
+{
+    if (!index) return;
+    free(index->start);
+    free(index->record);
+    free(index);
+}
+
+size_t anniversary_index_find(const struct AnniversaryIndex *index, int from, int to,
+                              size_t *records, int *dates, size_t max)
+{
+    size_t written = 0;
+    if (from < index->first) from = index->first;
+    if (to > index->first + index->days) to = index->first + index->days;
+    for (int date = from; date < to && written < max; date++) {
+        int d = date - index->first;
+        for (uint32_t k = index->start[d]; k < index->start[d + 1] && written < max; k++) {
+            records[written] = index->record[k];
+            if (dates) dates[written] = date;
+            written++;
+        }
+    }
+    return written;
+}
+
+size_t anniversary_index_week(const struct AnniversaryIndex *index, int date,
+                              size_t *records, int *dates, size_t max)
+{
+    int sunday = kday_on_or_before(date, 0);
+    return anniversary_index_find(index, sunday, sunday + 7, records, dates, max);
+}
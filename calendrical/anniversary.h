@@ -0,0 +1,61 @@
+#ifndef ANNIVERSARY_H
+#define ANNIVERSARY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "calendar.h"
+
+/* Yahrzeits and Hebrew birthdays of many people over a run of years, and
+ * an index of them by date.
+ *
+ * What an anniversary does in a given year depends on the original date
+ * only through a few facts about its year: whether it was a leap year,
+ * and for 30 Heshvan and 30 Kislev, the length of the year after. The
+ * batch functions work those out once per record, reducing each to a
+ * rule on the target year's months, and work out each target year's
+ * months once, so each anniversary is then a lookup and an add. The
+ * results are the same as yahrzeit's and hebrew_birthday's.
+ *
+ * Results are in columns by year: dates[y * count + i] is the anniversary
+ * of records[i] in year first_year + y, for y from 0 to years - 1. */
+
+struct HebrewRecord {
+    int month;
+    int day;
+    int year;
+};
+
+void yahrzeit_n(const struct HebrewRecord *deaths, size_t count,
+                int first_year, int years, int *dates);
+void hebrew_birthday_n(const struct HebrewRecord *births, size_t count,
+                       int first_year, int years, int *dates);
+
+/* The other way: which records have an anniversary on a date. The index
+ * holds each date's records together, so finding a day's or a week's is
+ * a lookup and a copy. Finding takes a const index and keeps no state
+ * of its own, so any number of threads can search one index at once. */
+
+struct AnniversaryIndex {
+    int first;          /* the earliest date */
+    int days;           /* dates covered, from first */
+    uint32_t *start;    /* date first + d has record[start[d]] up to record[start[d + 1]] */
+    uint32_t *record;   /* the record numbers, i of records[i] */
+};
+
+/* From the dates of yahrzeit_n or hebrew_birthday_n. Returns NULL if
+   memory can't be allocated, or there are 2^32 or more dates. */
+struct AnniversaryIndex *anniversary_index_create(const int *dates, size_t count,
+                                                  int years);
+void anniversary_index_destroy(struct AnniversaryIndex *index);
+
+/* Up to max of the records with an anniversary in [from, to), in order
+   of date, with the dates if dates isn't NULL. Returns how many were
+   written. */
+size_t anniversary_index_find(const struct AnniversaryIndex *index, int from, int to,
+                              size_t *records, int *dates, size_t max);
+
+/* The same for the week, Sunday to Saturday, that date is in. */
+size_t anniversary_index_week(const struct AnniversaryIndex *index, int date,
+                              size_t *records, int *dates, size_t max);
+
+#endif
@@ -0,0 +1,148 @@
+/* Load generator for calendard: throughput and latency percentiles.
+
+   usage: calbench [-n requests] [-d depth] [-c clients] [-o op] [socket]
+
+   Each client keeps depth requests in flight on its own connection. op is
+   chinese, hebrew, mayan or newyear; dates are random between 1900 and
+   2100. Latency is from a request being sent to its answer being read. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "calendar.h"
+#include "calclient.h"
+
+static const char *socket_path;
+static int requests = 100000, depth = 16, clients = 1;
+static enum CaldOp op = CALD_CHINESE_FROM_FIXED;
+static int first_date, dates;   /* 1900 through 2100, set before the clients start */
+
+struct Client {
+    pthread_t thread;
+    unsigned seed;
+    double *latencies;
+    int done;
+    bool failed;
+};
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void make_request(struct Client *c, struct CaldRequest *q)
+{
+    memset(q, 0, sizeof(*q));
+    q->op = op;
+    q->args[0] = op == CALD_CHINESE_NEW_YEAR ? 1900 + rand_r(&c->seed) % 201
+                                             : first_date + rand_r(&c->seed) % dates;
+}
+
+static void *run(void *arg)
+{
+    struct Client *c = arg;
+    struct CaldClient *client = cald_connect(socket_path);
+    double *sent = malloc(depth * sizeof(double));     /* in request order */
+    if (client == NULL || sent == NULL) {
+        c->failed = true;
+        cald_close(client);
+        free(sent);
+        return NULL;
+    }
+
+    int issued = 0, head = 0;
+    while (c->done < requests) {
+        while (issued < requests && issued - c->done < depth) {
+            struct CaldRequest q;
+            make_request(c, &q);
+            sent[issued % depth] = now();
+            if (!cald_send(client, &q, 1)) goto fail;
+            issued++;
+        }
+        struct CaldResponse r;
+        if (!cald_receive(client, &r) || r.status != CALD_OK) goto fail;
+        c->latencies[c->done++] = now() - sent[head];
+        head = (head + 1) % depth;
+    }
+    cald_close(client);
+    free(sent);
+    return NULL;
+
+fail:
+    c->failed = true;
+    cald_close(client);
+    free(sent);
+    return NULL;
+}
+
+static int compare(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char *argv[])
+{
+    static const char *ops[] = { "chinese", "hebrew", "mayan", "newyear" };
+    static const enum CaldOp op_codes[] = { CALD_CHINESE_FROM_FIXED,
+        CALD_HEBREW_FROM_FIXED, CALD_MAYAN_LONG_COUNT, CALD_CHINESE_NEW_YEAR };
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) requests = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) depth = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) clients = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            const char *name = argv[++i];
+            int k;
+            for (k = 0; k < 4 && strcmp(name, ops[k]) != 0; k++) ;
+            if (k == 4) {
+                fprintf(stderr, "calbench: unknown op %s\n", name);
+                return 2;
+            }
+            op = op_codes[k];
+        } else socket_path = argv[i];
+    }
+    if (requests < 1 || depth < 1 || clients < 1) {
+        fprintf(stderr, "usage: calbench [-n requests] [-d depth] [-c clients] [-o op] [socket]\n");
+        return 2;
+    }
+
+    struct Client *c = calloc(clients, sizeof(*c));
+    double *latencies = malloc((size_t)clients * requests * sizeof(double));
+    if (c == NULL || latencies == NULL) {
+        fprintf(stderr, "calbench: out of memory\n");
+        return 1;
+    }
+
+    first_date = fixed_from_gregorian(1900, 1, 1);
+    dates = fixed_from_gregorian(2101, 1, 1) - first_date;
+    double start = now();
+    for (int i = 0; i < clients; i++) {
+        c[i].seed = 12345 + i;
+        c[i].latencies = latencies + (size_t)i * requests;
+        pthread_create(&c[i].thread, NULL, run, &c[i]);
+    }
+    int total = 0;
+    bool failed = false;
+    for (int i = 0; i < clients; i++) {
+        pthread_join(c[i].thread, NULL);
+        failed = failed || c[i].failed;
+        memmove(latencies + total, c[i].latencies, c[i].done * sizeof(double));
+        total += c[i].done;
+    }
+    double elapsed = now() - start;
+    if (failed) fprintf(stderr, "calbench: lost the daemon at %s\n", cald_socket_path(socket_path));
+    if (total == 0) return 1;
+
+    qsort(latencies, total, sizeof(double), compare);
+    printf("%d requests, %d clients, depth %d: %.0f requests/s\n",
+           total, clients, depth, total / elapsed);
+    printf("latency p50 %.1f us, p99 %.1f us, max %.1f us\n",
+           latencies[total / 2] * 1e6, latencies[(int)(total * 0.99)] * 1e6,
+           latencies[total - 1] * 1e6);
+    return failed ? 1 : 0;
+}
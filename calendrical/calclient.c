@@ -0,0 +1,143 @@
+/*
+ *  calclient.c
+ *  Talking to calendard.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "calclient.h"
+
+const char *cald_socket_path(const char *path)
+{
+    if (path) return path;
+    path = getenv("CALENDRICAL_SOCKET");
+    return path && *path ? path : CALD_DEFAULT_SOCKET;
+}
+
+struct CaldClient *cald_connect(const char *path)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    path = cald_socket_path(path);
+    if (strlen(path) >= sizeof(addr.sun_path)) return NULL;
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return NULL;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return NULL;
+    }
+    struct CaldClient *client = malloc(sizeof(*client));
+    if (client == NULL) {
+        close(fd);
+        return NULL;
+    }
+    client->fd = fd;
+    client->next_id = 1;
+    return client;
+}
+
+void cald_close(struct CaldClient *client)
+{
+    if (client == NULL) return;
+    close(client->fd);
+    free(client);
+}
+
+static bool write_all(int fd, const void *buf, size_t n)
+{
+    const char *p = buf;
+    while (n > 0) {
+        ssize_t k = write(fd, p, n);
+        if (k < 0 && errno == EINTR) continue;
+        if (k <= 0) return false;
+        p += k;
+        n -= k;
+    }
+    return true;
+}
+
+static bool read_all(int fd, void *buf, size_t n)
+{
+    char *p = buf;
+    while (n > 0) {
+        ssize_t k = read(fd, p, n);
+        if (k < 0 && errno == EINTR) continue;
+        if (k <= 0) return false;
+        p += k;
+        n -= k;
+    }
+    return true;
+}
+
+bool cald_send(struct CaldClient *client, struct CaldRequest *requests, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        requests[i].id = client->next_id++;
+        requests[i].reserved = 0;
+    }
+    return write_all(client->fd, requests, n * sizeof(*requests));
+}
+
+bool cald_receive(struct CaldClient *client, struct CaldResponse *response)
+{
+    return read_all(client->fd, response, sizeof(*response));
+}
+
+bool cald_call(struct CaldClient *client, enum CaldOp op, const int32_t args[5],
+               struct CaldResponse *response)
+{
+    struct CaldRequest request = { .op = op };
+    if (args) memcpy(request.args, args, sizeof(request.args));
+    if (!cald_send(client, &request, 1)) return false;
+    if (!cald_receive(client, response)) return false;
+    return response->id == request.id && response->status == CALD_OK;
+}
+
+bool cald_chinese_from_fixed(struct CaldClient *client, int date, struct ChineseDate *cdate)
+{
+    struct CaldResponse r;
+    int32_t args[5] = { date };
+    if (!cald_call(client, CALD_CHINESE_FROM_FIXED, args, &r)) return false;
+    cdate->cycle = r.values[0];
+    cdate->year = r.values[1];
+    cdate->month = r.values[2];
+    cdate->leap = r.values[3];
+    cdate->day = r.values[4];
+    return true;
+}
+
+bool cald_fixed_from_chinese(struct CaldClient *client, struct ChineseDate cdate, int *rdate)
+{
+    struct CaldResponse r;
+    int32_t args[5] = { cdate.cycle, cdate.year, cdate.month, cdate.leap, cdate.day };
+    if (!cald_call(client, CALD_FIXED_FROM_CHINESE, args, &r)) return false;
+    if (rdate) *rdate = r.values[0];
+    return true;
+}
+
+bool cald_hebrew_from_fixed(struct CaldClient *client, int date,
+                            int *ryear, int *rmonth, int *rday)
+{
+    struct CaldResponse r;
+    int32_t args[5] = { date };
+    if (!cald_call(client, CALD_HEBREW_FROM_FIXED, args, &r)) return false;
+    if (ryear) *ryear = r.values[0];
+    if (rmonth) *rmonth = r.values[1];
+    if (rday) *rday = r.values[2];
+    return true;
+}
+
+bool cald_fixed_from_hebrew(struct CaldClient *client, int year, int month, int day,
+                            int *rdate)
+{
+    struct CaldResponse r;
+    int32_t args[5] = { year, month, day };
+    if (!cald_call(client, CALD_FIXED_FROM_HEBREW, args, &r)) return false;
+    if (rdate) *rdate = r.values[0];
+    return true;
+}
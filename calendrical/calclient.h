@@ -0,0 +1,91 @@
+#ifndef CALCLIENT_H
+#define CALCLIENT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "calendar.h"
+
+/* Client for calendard, which answers calendar queries over a Unix-domain
+ * socket and keeps the expensive results (Chinese and Hebrew years, new
+ * moons) warm between them.
+ *
+ * The protocol is fixed-size records in host byte order, since both ends
+ * are on the same machine. A client may send any number of requests
+ * before reading any responses; responses come back in request order.
+ * Most requests get one response. A range request gets one per result,
+ * with remaining counting down to 0 on the last, or a single CALD_EMPTY. */
+
+#define CALD_DEFAULT_SOCKET "/tmp/calendard.sock"
+#define CALD_MAX_RANGE 1024         /* most results for a range request */
+
+enum CaldOp {
+    CALD_CHINESE_FROM_FIXED,        /* date -> cycle, year, month, leap, day */
+    CALD_FIXED_FROM_CHINESE,        /* cycle, year, month, leap, day -> date */
+    CALD_HEBREW_FROM_FIXED,         /* date -> year, month, day */
+    CALD_FIXED_FROM_HEBREW,         /* year, month, day -> date */
+    CALD_MAYAN_LONG_COUNT,          /* date -> baktun, katun, tun, uinal, kin */
+    CALD_MAYAN_CALENDAR_ROUND,      /* date -> haab month, haab day,
+                                       tzolkin number, tzolkin name */
+    CALD_CHINESE_NEW_YEAR,          /* Gregorian year -> date */
+    CALD_CHINESE_MONTHS,            /* date -> for each month of its Chinese
+                                       year: first day, month, leap */
+    CALD_NEW_MOONS,                 /* from, to -> for each new moon in
+                                       [from, to): date, milliseconds into
+                                       the day (UT), lunation number */
+    CALD_OPS
+};
+
+enum CaldStatus {
+    CALD_OK,
+    CALD_BAD_OP,
+    CALD_BAD_RANGE,                 /* to < from, or too many results */
+    CALD_EMPTY,                     /* a range request with no results */
+    CALD_BAD_ARGS                   /* a year too far out, or no such month */
+};
+
+struct CaldRequest {
+    uint32_t id;
+    uint16_t op;
+    uint16_t reserved;
+    int32_t args[5];
+};
+
+struct CaldResponse {
+    uint32_t id;
+    int16_t status;
+    uint16_t remaining;             /* responses still to come for this request */
+    int32_t values[5];
+};
+
+struct CaldClient {
+    int fd;
+    uint32_t next_id;
+};
+
+/* path NULL means $CALENDRICAL_SOCKET, or CALD_DEFAULT_SOCKET without it. */
+const char *cald_socket_path(const char *path);
+
+/* Returns NULL if the daemon isn't there. */
+struct CaldClient *cald_connect(const char *path);
+void cald_close(struct CaldClient *client);
+
+/* Send requests without waiting for the answers. Each request's id is
+   filled in here, so responses can be matched to them. */
+bool cald_send(struct CaldClient *client, struct CaldRequest *requests, size_t n);
+bool cald_receive(struct CaldClient *client, struct CaldResponse *response);
+
+/* A request with a single response, sent and answered. */
+bool cald_call(struct CaldClient *client, enum CaldOp op, const int32_t args[5],
+               struct CaldResponse *response);
+
+/* The library's functions, answered by the daemon. These return false
+   if it couldn't be asked. */
+bool cald_chinese_from_fixed(struct CaldClient *client, int date, struct ChineseDate *cdate);
+bool cald_fixed_from_chinese(struct CaldClient *client, struct ChineseDate cdate, int *rdate);
+bool cald_hebrew_from_fixed(struct CaldClient *client, int date,
+                            int *ryear, int *rmonth, int *rday);
+bool cald_fixed_from_hebrew(struct CaldClient *client, int year, int month, int day,
+                            int *rdate);
+
+#endif
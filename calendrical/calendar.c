@@ -29,14 +29,21 @@
  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
  DEALINGS WITH THE SOFTWARE.
  */
+/* calendar.c always builds the out-of-line versions. */
+#undef CALENDRICAL_INLINE
+
 #include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <time.h>
-#include "moonphase.h"
 #include "calendar.h"
+#include "profile.h"
+#include "memo.h"
 
 #define MEAN_TROPICAL_YEAR 365.242189
 #define MEAN_SYNODIC_MONTH 29.530588853
+#define SHORTEST_LUNATION 29.2
 
 #define LONGITUDE_SPRING 0
 #define LONGITUDE_SUMMER 90
@@ -49,6 +56,7 @@
 #define EPOCH_HEBREW -1373427
 #define EPOCH_CHINESE -963099
 #define EPOCH_ISLAMIC 227015
+#define EPOCH_PERSIAN 226896
 #define EPOCH_MAYAN -1137142
 #define EPOCH_MAYAN_HAAB -1137490
 #define EPOCH_MAYAN_TZOLKIN -1137301
@@ -73,7 +81,7 @@ static double amod(double x, double y)
     return y + mod(x,-y);
 }
 
-static double poly(double x, int argc, double a[])
+static double poly(double x, int argc, const double a[])
 {
     double result = a[0];
     for (int i = 1; i < argc; i++) {
@@ -87,6 +95,11 @@ static double deg2rad(double deg)
     return deg * M_PI / 180.0;
 }
 
+static double rad2deg(double rad)
+{
+    return rad * 180.0 / M_PI;
+}
+
 static int signum(double num)
 {
     if (num < 0) return -1;
@@ -94,6 +107,11 @@ static int signum(double num)
     return 0;
 }
 
+/* The cheap arithmetic functions are in calendar_inline.h, so that
+   callers can have them inline. Here they become the library's. */
+#define CALENDRICAL_API
+#include "calendar_inline.h"
+
 #pragma mark Basics
 
 int fixed_from_struct_tm(struct tm *time)
@@ -101,160 +119,74 @@ int fixed_from_struct_tm(struct tm *time)
     return fixed_from_gregorian(time->tm_year+1900,time->tm_mon+1,time->tm_mday);
 }
 
-int fixed_from_unixtime(time_t time)
-{
-    return floor(time / 86400) + EPOCH_UNIXTIME;
-}
-
-double moment_from_unixtime(time_t time)
-{
-    return (time / 86400) + EPOCH_UNIXTIME;
-}
-
-/* Sunday is 0 */
-int day_of_week_from_fixed(int date)
-{
-    return (int)mod(date,7);
-}
-
-int kday_on_or_before(int date, int k)
+double moment_from_struct_tm(struct tm *time)
 {
-    return date - mod(date - k, 7);
+    return fixed_from_struct_tm(time) +
+        (time->tm_sec + 60 * (time->tm_min + 60 * time->tm_hour)) / 86400.0;
 }
 
-int kday_nearest(int date, int k)
-{
-    return kday_on_or_before(date + 3, k);
-}
-
-int kday_on_or_after(int date, int k)
-{
-    return kday_on_or_before(date + 6, k);
-}
-
-int kday_before(int date, int k)
-{
-    return kday_on_or_before(date - 1, k);
-}
-
-int kday_after(int date, int k)
-{
-    return kday_on_or_before(date + 7, k);
-}
-
-/* Sunday is 0. */
-int nth_kday(int n, int k, int year, int month, int day)
+/* Integer division truncates toward zero; we want the floor, so that
+   times before 1970 land on the right day. */
+int fixed_from_unixtime(time_t time)
 {
-    if (n > 0)
-        return 7 * n + kday_before(fixed_from_gregorian(year,month,day),k);
-
-    return 7 * n + kday_after(fixed_from_gregorian(year,month,day),k);
+    time_t days = time / 86400;
+    if (time % 86400 < 0) days--;
+    return (int)days + EPOCH_UNIXTIME;
 }
 
-/* Negative values of n count back from the end of the month. */
-int nth_kday_in_month(int n, int k, int year, int month)
+double moment_from_unixtime(time_t time)
 {
-    if (n > 0)
-        return kday_on_or_before(fixed_from_gregorian(year,month,7), k)
-            + (7 * (n - 1));
-    return
-        kday_on_or_before(fixed_from_gregorian(year,month,
-            last_day_of_gregorian_month(month, year)),k) + (7 * (1 + n));
+    return time / 86400.0 + EPOCH_UNIXTIME;
 }
 
-double moment_from_jd(double jd)
-{
-    return jd + EPOCH_JD;
-}
+/* Batch forms. utc_offset is in seconds east of UTC, so that the
+   dates come out in a fixed time zone; pass 0 for UTC. */
 
-double jd_from_moment(double t)
+/* Whole days in seconds, rounded down. This divides in double rather
+   than integer, and corrects the truncation by hand rather than calling
+   floor(), so that the loops using it vectorize. It's exact for any
+   result that fits in an int. */
+static inline int floor_days(double seconds)
 {
-    return t - EPOCH_JD;
+    double q = seconds / 86400;
+    int days = (int)q;
+    return days - (q < days);
 }
 
-int fixed_from_jd(double jd)
+void fixed_from_unixtime_n(const time_t *restrict times, int *restrict dates,
+                           size_t n, long utc_offset)
 {
-    return floor(jd + EPOCH_JD);
+    for (size_t i = 0; i < n; i++)
+        dates[i] = floor_days((double)(times[i] + utc_offset)) + EPOCH_UNIXTIME;
 }
 
-double jd_from_fixed(int date)
+void moment_from_unixtime_n(const time_t *restrict times, double *restrict moments,
+                            size_t n, long utc_offset)
 {
-    return jd_from_moment((double)date);
+    for (size_t i = 0; i < n; i++)
+        moments[i] = (double)(times[i] + utc_offset) / 86400 + EPOCH_UNIXTIME;
 }
 
-int fixed_from_mjd(int mjd)
+/* tv_nsec is always 0 to 999999999, so it can't change the date. */
+void fixed_from_timespec_n(const struct timespec *restrict times, int *restrict dates,
+                           size_t n, long utc_offset)
 {
-    return mjd + EPOCH_MJD;
+    for (size_t i = 0; i < n; i++)
+        dates[i] = floor_days((double)(times[i].tv_sec + utc_offset))
+                    + EPOCH_UNIXTIME;
 }
 
-int mjd_from_fixed(int date)
+/* A moment near the present is good to about 10 microseconds. */
+void moment_from_timespec_n(const struct timespec *restrict times,
+                            double *restrict moments, size_t n, long utc_offset)
 {
-    return date - EPOCH_MJD;
+    for (size_t i = 0; i < n; i++)
+        moments[i] = ((double)(times[i].tv_sec + utc_offset)
+                      + times[i].tv_nsec * 1e-9) / 86400 + EPOCH_UNIXTIME;
 }
 
 #pragma mark Gregorian
 
-bool gregorian_leap_year(int year)
-{
-    return (
-        mod(year, 4) == 0 &&
-        !(mod(year, 400) == 100 ||
-          mod(year, 400) == 200 ||
-          mod(year, 400) == 300)) ? true : false;
-}
-
-int last_day_of_gregorian_month(int month, int year)
-{
-    if (month == 2 && gregorian_leap_year(year))
-        return 29;
-    switch (month) {
-        case  1: return 31;
-        case  2: return 28;
-        case  3: return 31;
-        case  4: return 30;
-        case  5: return 31;
-        case  6: return 30;
-        case  7: return 31;
-        case  8: return 31;
-        case  9: return 30;
-        case 10: return 31;
-        case 11: return 30;
-        case 12: return 31;
-        default: return 0;
-    }
-}
-
-int fixed_from_gregorian(int year, int month, int day)
-{
-    int correction,f;
-    if (month <= 2) correction = 0;
-    else if (month > 2 && gregorian_leap_year(year)) correction = -1;
-    else correction = -2;
-
-    f = 365 * (year - 1) +
-        floor((year - 1) / 4.0) -
-        floor((year - 1) / 100.0) +
-        floor((year - 1) / 400.0) +
-        floor((367 * month - 362) / 12.0) +
-        correction + day;
-    return f;
-}
-
-int gregorian_year_from_fixed(int date)
-{
-    int d0 = date - 1;
-    int n400 = (int)floor(d0 / 146097.0);
-    int d1 = mod(d0, 146097);
-    int n100 = (int)floor(d1 / 36524.0);
-    int d2 = mod(d1, 36524);
-    int n4 = (int)floor(d2 / 1461.0);
-    int d3 = mod(d2, 1461);
-    int n1 = (int)floor(d3 / 365.0);
-    int year = 400 * n400 + 100 * n100 + 4 * n4 + n1;
-    if (n100 == 4 || n1 == 4) return year;
-    return year + 1;
-}
-
 void gregorian_from_fixed(int date, int *ryear, int *rmonth, int *rday)
 {
     int year = gregorian_year_from_fixed(date);
@@ -277,49 +209,6 @@ void gregorian_from_fixed(int date, int *ryear, int *rmonth, int *rday)
 
 #pragma mark Julian
 
-bool julian_leap_year(int year)
-{
-    return (year != 4 && mod(year, 4) == 0) ? true : false;
-}
-
-int last_day_of_julian_month(int month, int year)
-{
-    if (month == 2 && julian_leap_year(year))
-        return 29;
-    switch (month) {
-        case  1: return 31;
-        case  2: return 28;
-        case  3: return 31;
-        case  4: return 30;
-        case  5: return 31;
-        case  6: return 30;
-        case  7: return 31;
-        case  8: return 31;
-        case  9: return 30;
-        case 10: return 31;
-        case 11: return 30;
-        case 12: return 31;
-        default: return 0;
-    }
-}
-
-int fixed_from_julian(int year, int month, int day)
-{
-    int correction,y,f;
-    if (month <= 2) correction = 0;
-    else if (julian_leap_year(year)) correction = -1;
-    else correction = -2;
-
-    if (year < 0) y = year + 1;
-    else y = year;
-
-    f = -2 + (365 * (y - 1)) +
-        floor((y - 1) / 4.0) +
-        floor((367 * month - 362) / 12.0) +
-        correction + day;
-    return f;
-}
-
 void julian_from_fixed(int date, int *ryear, int *rmonth, int *rday)
 {
     int approx = floor((4 * (date + 1) + 1464) / 1461.0);
@@ -340,25 +229,6 @@ void julian_from_fixed(int date, int *ryear, int *rmonth, int *rday)
 
 #pragma mark Islamic
 
-bool islamic_leap_year(int year)
-{
-    return mod(14 + (11 * year), 30) < 11 ? true : false;
-}
-
-int last_day_of_islamic_month(int month, int year)
-{
-    return (oddp(month) ||
-        ((month == 12) && islamic_leap_year(year))) ?
-        30 : 29;
-}
-
-int fixed_from_islamic(int year, int month, int day) {
-    return day + (29 * (month - 1)) + floor((6 * month - 1) / 11.0) +
-            (year - 1) * 354 +
-            floor((3 + (11 * year)) / 30.0) +
-            EPOCH_ISLAMIC - 1;
-}
-
 void islamic_from_fixed(int date, int *ryear, int *rmonth, int *rday)
 {
     int prior_days, year, month, day;
@@ -374,11 +244,6 @@ void islamic_from_fixed(int date, int *ryear, int *rmonth, int *rday)
 
 #pragma mark Hebrew
 
-bool hebrew_leap_year(int year)
-{
-    return (mod(1 + (7 * year), 19) < 7) ? true : false;
-}
-
 int last_month_of_hebrew_year(int year)
 {
     return (hebrew_leap_year(year)) ? 13 : 12;
@@ -401,7 +266,7 @@ int last_day_of_hebrew_month(int month, int year)
 int hebrew_calendar_elapsed_days(int year)
 {
     int months_elapsed = floor((235 * year - 234) / 19.0);
-    double parts_elapsed = 12084 + 13753 * months_elapsed;
+    double parts_elapsed = 12084 + 13753.0 * months_elapsed;
     int day = 29 * months_elapsed + floor(parts_elapsed / 25920.0);
     return mod(3 * (day + 1), 7) < 3 ? day + 1 : day;
 }
@@ -476,6 +341,23 @@ void hebrew_from_fixed(int date, int *ryear, int *rmonth, int *rday)
     if (rday) *rday = day;
 }
 
+void hebrew_year_info(int year, struct HebrewYearInfo *info)
+{
+    int days = days_in_hebrew_year(year);
+    int date = hebrew_new_year(year);
+    info->year = year;
+    info->months = last_month_of_hebrew_year(year);
+    for (int i = 0; i < info->months; i++) {
+        int month = i < info->months - 6 ? i + 7 : i - info->months + 7;
+        info->month_start[i] = date;
+        /* last_day_of_hebrew_month, knowing the year's length */
+        if (month == 8) date += days == 355 || days == 385 ? 30 : 29;
+        else if (month == 9) date += days == 353 || days == 383 ? 29 : 30;
+        else date += last_day_of_hebrew_month(month, year);
+    }
+    info->month_start[info->months] = date;
+}
+
 int hebrew_birthday(int birth_month, int birth_day, int birth_year, int year)
 {
     return
@@ -667,9 +549,13 @@ double midnight_in_china(int date)
    Pass date+1 for UTC. */
 int current_major_solar_term(int date)
 {
+    int term;
+    if (memo_lookup(MEMO_MAJOR_SOLAR_TERM, date, &term)) return term;
     struct Locale *b = chinese_location((double)date);
     double s = solar_longitude(universal_from_standard(date,*b));
-    return amod(2 + floor(s / 30.0), 12);
+    term = amod(2 + floor(s / 30.0), 12);
+    memo_store(MEMO_MAJOR_SOLAR_TERM, date, term);
+    return term;
 }
 
 /* This assumes the date is being passed in the Chinese time zone.
@@ -683,29 +569,43 @@ int current_minor_solar_term(int date)
 
 int chinese_winter_solstice_on_or_before(int date)
 {
+    int solstice;
+    if (memo_lookup(MEMO_WINTER_SOLSTICE, date, &solstice)) return solstice;
+    PROFILE_FUNCTION(PROFILE_CHINESE_WINTER_SOLSTICE);
     double approx = estimate_prior_solar_longitude(midnight_in_china(date + 1), LONGITUDE_WINTER);
     int i = (int)floor(approx) - 1;
     while (LONGITUDE_WINTER > solar_longitude(midnight_in_china(i + 1))) {
+        PROFILE_ITERATION(PROFILE_CHINESE_WINTER_SOLSTICE);
         i++;
     }
+    memo_store(MEMO_WINTER_SOLSTICE, date, i);
     return i;
 }
 
 int chinese_new_moon_on_or_after(int date)
 {
+    int moon;
+    if (memo_lookup(MEMO_NEW_MOON_ON_OR_AFTER, date, &moon)) return moon;
     double t = new_moon_after(midnight_in_china(date));
-    return (int)floor(standard_from_universal(t,*chinese_location(t)));
+    moon = (int)floor(standard_from_universal(t,*chinese_location(t)));
+    memo_store(MEMO_NEW_MOON_ON_OR_AFTER, date, moon);
+    return moon;
 }
 
 int chinese_new_moon_before(int date)
 {
+    int moon;
+    if (memo_lookup(MEMO_NEW_MOON_BEFORE, date, &moon)) return moon;
     double t = new_moon_before(midnight_in_china(date));
-    return (int)floor(standard_from_universal(t,*chinese_location(t)));
+    moon = (int)floor(standard_from_universal(t,*chinese_location(t)));
+    memo_store(MEMO_NEW_MOON_BEFORE, date, moon);
+    return moon;
 }
 
 /* True if lunar month starting on date has no major solar term. */
 bool no_major_solar_term(int date)
 {
+    PROFILE_FUNCTION(PROFILE_NO_MAJOR_SOLAR_TERM);
     return current_major_solar_term(date) ==
             current_major_solar_term(chinese_new_moon_on_or_after(date + 1)) ?
             true : false;
@@ -714,12 +614,14 @@ bool no_major_solar_term(int date)
 /* True if there is a leap month on or after date1 and at or before date2. */
 bool prior_leap_month(int date1, int date2)
 {
+    PROFILE_FUNCTION(PROFILE_PRIOR_LEAP_MONTH);
     return (date2 >= date1 && (no_major_solar_term(date2) ||
             prior_leap_month(date1,chinese_new_moon_before(date2)))) ? true : false;
 }
 
 int chinese_new_year_in_sui(int date)
 {
+    PROFILE_FUNCTION(PROFILE_CHINESE_NEW_YEAR_IN_SUI);
     int s1 = chinese_winter_solstice_on_or_before(date);
     int s2 = chinese_winter_solstice_on_or_before(s1 + 370);
     int m12 = chinese_new_moon_on_or_after(s1 + 1);
@@ -761,8 +663,18 @@ char *chinese_zodiac_animal(int date)
     return Branches[branch].zodiac;
 }
 
+static void chinese_cycle_and_year(int date, int month, int *rcycle, int *ryear)
+{
+    int ep = fixed_from_gregorian(-2636,2,15);
+    int elapsed_years = (int)floor(1.5 - (month / 12.0) +
+                        (date - ep) / MEAN_TROPICAL_YEAR);
+    *rcycle = (int)floor((elapsed_years - 1) / 60.0) + 1;
+    *ryear = amod(elapsed_years,60);
+}
+
 void chinese_from_fixed(int date, struct ChineseDate *cdate)
 {
+    PROFILE_FUNCTION(PROFILE_CHINESE_FROM_FIXED);
     int s1 = chinese_winter_solstice_on_or_before(date);
     int s2 = chinese_winter_solstice_on_or_before(s1 + 370);
     int m12 = chinese_new_moon_on_or_after(s1 + 1);
@@ -775,16 +687,13 @@ void chinese_from_fixed(int date, struct ChineseDate *cdate)
     cdate->leap = leap_year &&
             no_major_solar_term(m) &&
             ! prior_leap_month(m12, chinese_new_moon_before(m)) ? true : false;
-    int ep = fixed_from_gregorian(-2636,2,15);
-    int elapsed_years = (int)floor(1.5 - (cdate->month / 12.0) +
-                        (date - ep) / MEAN_TROPICAL_YEAR);
-    cdate->cycle = (int)floor((elapsed_years - 1) / 60.0) + 1;
-    cdate->year = amod(elapsed_years,60);
+    chinese_cycle_and_year(date, cdate->month, &cdate->cycle, &cdate->year);
     cdate->day = date - m + 1;
 }
 
 int fixed_from_chinese(struct ChineseDate cdate)
 {
+    PROFILE_FUNCTION(PROFILE_FIXED_FROM_CHINESE);
     int mid_year = (int)floor(EPOCH_CHINESE + ((cdate.cycle - 1) *
             60 + (cdate.year - 1) + 0.5) * MEAN_TROPICAL_YEAR);
     int new_year = chinese_new_year_on_or_before(mid_year);
@@ -799,6 +708,86 @@ int fixed_from_chinese(struct ChineseDate cdate)
     return prior_new_moon + cdate.day - 1;
 }
 
+/* The leap month of the sui starting at winter solstice s1: the first
+   month with no major solar term, if the sui has 13 months. */
+static bool chinese_leap_month_in_sui(int s1, int *rleap)
+{
+    int s2 = chinese_winter_solstice_on_or_before(s1 + 370);
+    int m12 = chinese_new_moon_on_or_after(s1 + 1);
+    int next_m11 = chinese_new_moon_before(s2 + 1);
+    if ((int)round((next_m11 - m12) / MEAN_SYNODIC_MONTH) != 12) return false;
+    for (int m = m12; m < next_m11; m = chinese_new_moon_on_or_after(m + 1)) {
+        if (no_major_solar_term(m)) {
+            *rleap = m;
+            return true;
+        }
+    }
+    return false;
+}
+
+void chinese_year_info(int date, struct ChineseYearInfo *info)
+{
+    int new_year = chinese_new_year_on_or_before(date);
+    int next_year = chinese_new_year_on_or_before(new_year + 400);
+
+    info->new_year = new_year;
+    info->months = 0;
+    for (int m = new_year; m < next_year && info->months < 13;
+         m = chinese_new_moon_on_or_after(m + 1))
+        info->month_start[info->months++] = m;
+    info->month_start[info->months] = next_year;
+
+    /* A year runs from partway through one sui into the next; a leap
+       month could come from either. */
+    info->leap_month = -1;
+    if (info->months == 13) {
+        int s = chinese_winter_solstice_on_or_before(new_year);
+        for (int k = 0; k < 2 && info->leap_month < 0; k++) {
+            int leap;
+            if (chinese_leap_month_in_sui(s, &leap))
+                for (int i = 1; i < info->months; i++)
+                    if (info->month_start[i] == leap) info->leap_month = i;
+            s = chinese_winter_solstice_on_or_before(s + 370);
+        }
+    }
+    chinese_cycle_and_year(new_year, 1, &info->cycle, &info->year);
+}
+
+/* After the leap month, the index in month_start runs one ahead of the
+   month number. */
+void chinese_from_fixed_with(const struct ChineseYearInfo *info, int date,
+                             struct ChineseDate *cdate)
+{
+    if (date < info->new_year || date >= info->month_start[info->months]) {
+        chinese_from_fixed(date, cdate);
+        return;
+    }
+    int lo = 0, hi = info->months - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (info->month_start[mid] <= date) lo = mid;
+        else hi = mid - 1;
+    }
+    cdate->cycle = info->cycle;
+    cdate->year = info->year;
+    cdate->month = (info->leap_month < 0 || lo < info->leap_month) ? lo + 1 : lo;
+    cdate->leap = lo == info->leap_month;
+    cdate->day = date - info->month_start[lo] + 1;
+}
+
+int fixed_from_chinese_with(const struct ChineseYearInfo *info, struct ChineseDate cdate)
+{
+    int i;
+    if (cdate.leap) i = cdate.month == info->leap_month ? cdate.month : -1;
+    else if (info->leap_month < 0 || cdate.month <= info->leap_month) i = cdate.month - 1;
+    else i = cdate.month;
+
+    if (cdate.cycle != info->cycle || cdate.year != info->year ||
+        i < 0 || i >= info->months)
+        return fixed_from_chinese(cdate);
+    return info->month_start[i] + cdate.day - 1;
+}
+
 #pragma mark Mayan
 
 char *HaabMonths[] = { NULL, "Pop", "Uo", "Zip", "Zotz", "Tzec", "Xul",
@@ -809,12 +798,6 @@ char *TzolkinNames[] = { NULL, "Imix", "Ik", "Akbal", "Kan", "Chicchan",
     "Cimi", "Manik", "Lamat", "Muluc", "Oc", "Chuen", "Eb", "Ben", "Ix",
     "Men", "Cib", "Caban", "Etznab", "Cauac", "Ahau" };
 
-int fixed_from_mayan_long_count(int baktun, int katun, int tun, int uinal, int kin)
-{
-    return EPOCH_MAYAN + baktun * 144000 + katun * 7200 +
-            tun * 360 + uinal * 20 + kin;
-}
-
 void mayan_long_count_from_fixed(int date, int *rbaktun, int *rkatun,
                                     int *rtun, int *ruinal, int *rkin)
 {
@@ -835,11 +818,6 @@ void mayan_long_count_from_fixed(int date, int *rbaktun, int *rkatun,
     if (rkin) *rkin = kin;
 }
 
-int mayan_haab_ordinal(int month, int day)
-{
-    return ((month - 1) * 20 + day);
-}
-
 void mayan_haab_from_fixed(int date, int *rmonth, int *rday)
 {
     int count = mod(date - EPOCH_MAYAN_HAAB, 365);
@@ -856,11 +834,6 @@ int mayan_haab_on_or_before(int date, int haab_month, int haab_day)
                 mayan_haab_ordinal(haab_month,haab_day)),365);
 }
 
-int mayan_tzolkin_ordinal(int number, int name)
-{
-    return mod(number - 1 + 39 * (number - name), 260);
-}
-
 void mayan_tzolkin_from_fixed(int date, int *rnumber, int *rname)
 {
     int count = date - EPOCH_MAYAN_TZOLKIN + 1;
@@ -878,11 +851,6 @@ int mayan_tzolkin_on_or_before(int date, int number, int name)
 
 #pragma mark ISO
 
-int fixed_from_iso(int year, int week, int day)
-{
-    return nth_kday(week, 0, year - 1, 12, 28) + day;
-}
-
 void iso_from_fixed(int date, int *ryear, int *rweek, int *rday)
 {
     int approx = gregorian_year_from_fixed(date - 3);
@@ -991,6 +959,7 @@ static double zvec[] = {
 static int vlen = 49;
 double solar_longitude(double t)
 {
+    PROFILE_FUNCTION(PROFILE_SOLAR_LONGITUDE);
     double c = julian_centuries(t);
     double sigma = 0.0;
     for (int i = 0; i < vlen; i++) {
@@ -1001,9 +970,193 @@ double solar_longitude(double t)
     return mod(longitude + aberration(t) + nuation(t), 360);
 }
 
+/* ephemeris_correction depends only on the Gregorian year, so a run of
+   moments can share it. first == last holds no year. */
+struct EphemerisYear {
+    int first, last;
+    double correction;
+};
+
+static double ephemeris_correction_in(struct EphemerisYear *year, double t)
+{
+    int date = (int)floor(t);
+    if (date < year->first || date >= year->last) {
+        int y = gregorian_year_from_fixed(date);
+        year->first = fixed_from_gregorian(y, 1, 1);
+        year->last = fixed_from_gregorian(y + 1, 1, 1);
+        year->correction = ephemeris_correction(t);
+    }
+    return year->correction;
+}
+
+#if defined(__GNUC__)
+/* The _n forms work on eight moments at a time in vectors, which the
+   compiler maps onto whatever vector registers the target has. On x86-64
+   Linux with GCC there are AVX2 and AVX-512 versions, chosen at load
+   time. They need their own sine, since libm's works on one number. */
+typedef double vdouble __attribute__((vector_size(64)));
+#define LANES 8
+
+#if defined(__x86_64__) && defined(__linux__) && !defined(__clang__)
+#define VECTOR_CLONES __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define VECTOR_CLONES
+#endif
+
+/* The vector helpers replace a vector in place, through a pointer, so
+   that no vector is passed or returned by value: GCC notes (and no pragma
+   silences) that the ABI for that changed, even for inlined functions. */
+#define VECTOR_INLINE static inline __attribute__((always_inline))
+
+/* Adding and subtracting 1.5 * 2^52 rounds to an integer, for
+   magnitudes below 2^51. */
+VECTOR_INLINE void vround(vdouble *x)
+{
+    const vdouble big = (vdouble){ 0 } + 6755399441055744.0;
+    *x = (*x + big) - big;
+}
+
+VECTOR_INLINE void vfloor(vdouble *x)
+{
+    vdouble r = *x;
+    vround(&r);
+    *x = r + __builtin_convertvector(r > *x, vdouble);      /* true is -1 */
+}
+
+/* Sine of x degrees. Reducing by multiples of 180 leaves |r| <= 90,
+   with the sign flipped for odd multiples; the Taylor series to r^23
+   is then good to below an ulp. */
+VECTOR_INLINE void vsin_degrees(vdouble *x)
+{
+    vdouble n = *x * (1 / 180.0);
+    vround(&n);
+    vdouble half = n * 0.5, whole = half;
+    vround(&whole);
+    half -= whole;                                          /* 0 or +-0.5 */
+    vdouble sign = 1 - 8 * half * half;
+    vdouble r = (*x - 180 * n) * (M_PI / 180.0);
+    vdouble r2 = r * r;
+    vdouble p = (vdouble){ 0 } + 1 / 25852016738884976640000.0;    /* 1/23! */
+    p = p * -r2 + 1 / 51090942171709440000.0;
+    p = p * -r2 + 1 / 121645100408832000.0;
+    p = p * -r2 + 1 / 355687428096000.0;
+    p = p * -r2 + 1 / 1307674368000.0;
+    p = p * -r2 + 1 / 6227020800.0;
+    p = p * -r2 + 1 / 39916800.0;
+    p = p * -r2 + 1 / 362880.0;
+    p = p * -r2 + 1 / 5040.0;
+    p = p * -r2 + 1 / 120.0;
+    p = p * -r2 + 1 / 6.0;
+    p = p * -r2 + 1;
+    *x = sign * r * p;
+}
+
+VECTOR_INLINE void vpoly(vdouble *x, int argc, const double a[])
+{
+    vdouble result = (vdouble){ 0 } + a[argc - 1];
+    for (int i = argc - 2; i >= 0; i--) result = result * *x + a[i];
+    *x = result;
+}
+
+VECTOR_INLINE void vaberration(vdouble *c)
+{
+    vdouble s = 177.63 + 35999.01848 * *c + 90;
+    vsin_degrees(&s);
+    *c = 0.0000974 * s - 0.0005575;
+}
+
+VECTOR_INLINE void vnuation(vdouble *c)
+{
+    vdouble a = *c, b = *c;
+    vpoly(&a, 3, avec);
+    vsin_degrees(&a);
+    vpoly(&b, 3, bvec);
+    vsin_degrees(&b);
+    *c = -0.004778 * a + -0.0003667 * b;
+}
+
+VECTOR_INLINE void vsolar_longitude(vdouble *c)
+{
+    vdouble sigma = (vdouble){ 0 };
+    for (int i = 0; i < vlen; i++) {
+        vdouble s = yvec[i] + zvec[i] * *c;
+        vsin_degrees(&s);
+        sigma += xvec[i] * s;
+    }
+    vdouble longitude = 282.7771834 + 36000.76953744 * *c
+                        + 0.000005729577951308232 * sigma;
+    vdouble aberration = *c, nuation = *c;
+    vaberration(&aberration);
+    vnuation(&nuation);
+    longitude += aberration + nuation;
+    vdouble turns = longitude * (1 / 360.0);
+    vfloor(&turns);
+    *c = longitude - 360 * turns;
+}
+
+enum { ABERRATION, NUATION, SOLAR_LONGITUDE };
+
+static void julian_centuries_n(const double *t, double *c, size_t n)
+{
+    struct EphemerisYear year = { 0, 0, 0 };
+    for (size_t i = 0; i < n; i++)
+        c[i] = (t[i] + ephemeris_correction_in(&year, t[i]) - 730120.5) / 36525.0;
+}
+
+VECTOR_CLONES
+static void solar_n(int what, const double *restrict t, double *restrict out, size_t n)
+{
+    for (size_t i = 0; i < n; i += LANES) {
+        size_t k = n - i < LANES ? n - i : LANES;
+        double c[LANES];
+        vdouble v;
+        julian_centuries_n(t + i, c, k);
+        for (size_t j = k; j < LANES; j++) c[j] = c[k - 1];
+        memcpy(&v, c, sizeof(v));
+        switch (what) {
+            case ABERRATION: vaberration(&v); break;
+            case NUATION: vnuation(&v); break;
+            default: vsolar_longitude(&v); break;
+        }
+        memcpy(out + i, &v, k * sizeof(double));
+    }
+}
+
+void aberration_n(const double *t, double *out, size_t n)
+{
+    solar_n(ABERRATION, t, out, n);
+}
+
+void nuation_n(const double *t, double *out, size_t n)
+{
+    solar_n(NUATION, t, out, n);
+}
+
+void solar_longitude_n(const double *t, double *out, size_t n)
+{
+    solar_n(SOLAR_LONGITUDE, t, out, n);
+}
+#else
+void aberration_n(const double *t, double *out, size_t n)
+{
+    for (size_t i = 0; i < n; i++) out[i] = aberration(t[i]);
+}
+
+void nuation_n(const double *t, double *out, size_t n)
+{
+    for (size_t i = 0; i < n; i++) out[i] = nuation(t[i]);
+}
+
+void solar_longitude_n(const double *t, double *out, size_t n)
+{
+    for (size_t i = 0; i < n; i++) out[i] = solar_longitude(t[i]);
+}
+#endif
+
 /* Moment at or after t when solar longitude will be target degrees. */
 double solar_longitude_after(double t, double target)
 {
+    PROFILE_FUNCTION(PROFILE_SOLAR_LONGITUDE_AFTER);
     double v = 0.00001;
     double rate = MEAN_TROPICAL_YEAR / 360.0;
     double tau = t + rate * mod(target - solar_longitude(t), 360);
@@ -1012,6 +1165,7 @@ double solar_longitude_after(double t, double target)
 
     double lo = l, hi = u, x = (hi + lo) / 2;
     while (hi - lo > v) {
+        PROFILE_ITERATION(PROFILE_SOLAR_LONGITUDE_AFTER);
         if (mod(solar_longitude(x) - target, 360) < 180) hi = x;
         else lo = x;
         x = (hi + lo) / 2;
@@ -1022,6 +1176,7 @@ double solar_longitude_after(double t, double target)
 /* Approximate moment at or before t when solar longitude was target. */
 double estimate_prior_solar_longitude(double t, double target)
 {
+    PROFILE_FUNCTION(PROFILE_ESTIMATE_PRIOR_SOLAR_LONGITUDE);
     double rate = MEAN_TROPICAL_YEAR / 360;
     double tau = t - rate * mod(solar_longitude(t) - target, 360);
     double d = mod(solar_longitude(tau) - target + 180, 360) - 180;
@@ -1055,6 +1210,7 @@ static double nm_l_vec[] = { 0.000165, 0.000164, 0.000126, 0.000110, 0.000062, 0
 static double nm_extra_vec[] = { 299.77, 132.8475848, -0.009173 };
 double nth_new_moon(int n)
 {
+    PROFILE_FUNCTION(PROFILE_NTH_NEW_MOON);
     double k = n - 24724;
     double c = k / 1236.85;
     double approx = poly(c, 5, nm_approx_vec);
@@ -1078,18 +1234,178 @@ double nth_new_moon(int n)
     return universal_from_dynamical(approx + correction + extra + additional);
 }
 
+/* cos and sin of an angle, so that it can be turned by another angle
+   with a few multiplications instead of calling sin. */
+struct Rotor {
+    double cos, sin;
+};
+
+static const struct Rotor no_turn = { 1, 0 };
+
+static struct Rotor rotor(double degrees)
+{
+    double r = deg2rad(mod(degrees, 360));
+    return (struct Rotor){ cos(r), sin(r) };
+}
+
+static struct Rotor turn(struct Rotor a, struct Rotor b)
+{
+    return (struct Rotor){ a.cos * b.cos - a.sin * b.sin,
+                           a.sin * b.cos + a.cos * b.sin };
+}
+
+static struct Rotor reverse(struct Rotor a)
+{
+    return (struct Rotor){ a.cos, -a.sin };
+}
+
+/* An angle that's a polynomial in c, as c steps by h: the angle, its
+   step, and the turn of its step from one to the next. That's exact for
+   a quadratic; the cubic and quartic terms of the lunar arguments move
+   the step too little to matter over a few dozen steps. */
+struct Sweep {
+    struct Rotor angle, step, accel;
+};
+
+static void sweep_start(struct Sweep *s, double c, double h, int argc, const double a[])
+{
+    /* The differences of each power are built up from the one below, so
+       large terms don't cancel: (c+h)^i - c^i and (c+2h)^i - (c+h)^i. */
+    double p1 = 1, p2 = 1, d1 = 0, e1 = 0;
+    double first = 0, second = 0;
+    for (int i = 1; i < argc; i++) {
+        d1 = c * d1 + h * p1;
+        e1 = (c + h) * e1 + h * p2;
+        p1 *= c + h;
+        p2 *= c + 2 * h;
+        first += a[i] * d1;
+        second += a[i] * (e1 - d1);
+    }
+    s->angle = rotor(poly(c, argc, a));
+    s->step = rotor(first);
+    s->accel = rotor(second);
+}
+
+static void sweep_next(struct Sweep *s)
+{
+    s->angle = turn(s->angle, s->step);
+    s->step = turn(s->step, s->accel);
+}
+
+static double horner(double x, int argc, const double a[])
+{
+    double result = a[argc - 1];
+    for (int i = argc - 2; i >= 0; i--) result = result * x + a[i];
+    return result;
+}
+
+/* How many lunations nth_new_moons steps before recomputing the angles
+   outright, which keeps rounding in the rotors from building up. */
+#define NEW_MOON_REANCHOR 64
+
+/* nth_new_moon for n0, n0 + 1, ... Every argument advances by nearly
+   the same angle each lunation, so after the first of each run of
+   NEW_MOON_REANCHOR they are turned rather than recomputed. */
+void nth_new_moons(int n0, size_t count, double *out)
+{
+    const double h = 1 / 1236.85;
+    struct EphemerisYear year = { 0, 0, 0 };
+    struct Sweep solar, lunar, moon, omega, extra;
+    struct Rotor additional[13], additional_step[13];
+    for (int j = 0; j < 13; j++) additional_step[j] = rotor(nm_j_vec[j]);
+
+    for (size_t i = 0; i < count; i++) {
+        double k = (double)n0 + (double)i - 24724;
+        double c = k / 1236.85;
+        if (i % NEW_MOON_REANCHOR == 0) {
+            sweep_start(&solar, c, h, 4, nm_solaranom_vec);
+            sweep_start(&lunar, c, h, 5, nm_lunaranom_vec);
+            sweep_start(&moon, c, h, 5, nm_moonarg_vec);
+            sweep_start(&omega, c, h, 4, nm_omega_vec);
+            sweep_start(&extra, c, h, 3, nm_extra_vec);
+            for (int j = 0; j < 13; j++) additional[j] = rotor(nm_i_vec[j] + nm_j_vec[j] * k);
+        }
+
+        /* Multiples of the arguments, indexed from the least used. */
+        struct Rotor m[5], l[5], f[5];
+        m[0] = reverse(solar.angle);
+        m[1] = no_turn;
+        m[2] = solar.angle;
+        m[3] = turn(m[2], m[2]);
+        m[4] = turn(m[3], m[2]);
+        l[0] = no_turn;
+        l[1] = lunar.angle;
+        for (int j = 2; j < 5; j++) l[j] = turn(l[j - 1], l[1]);
+        f[2] = no_turn;
+        f[3] = moon.angle;
+        f[4] = turn(f[3], f[3]);
+        f[1] = reverse(f[3]);
+        f[0] = reverse(f[4]);
+
+        double E = horner(c, 3, nm_E_vec);
+        double correction = -0.00017 * omega.angle.sin;
+        for (int j = 0; j < 24; j++) {
+            struct Rotor r = turn(turn(m[nm_x_vec[j] + 1], l[nm_y_vec[j]]), f[nm_z_vec[j] + 2]);
+            double e = nm_w_vec[j] == 0 ? 1 : nm_w_vec[j] == 1 ? E : E * E;
+            correction += nm_v_vec[j] * e * r.sin;
+        }
+        double sum = 0.0;
+        for (int j = 0; j < 13; j++) {
+            sum += nm_l_vec[j] * additional[j].sin;
+            additional[j] = turn(additional[j], additional_step[j]);
+        }
+        double t = horner(c, 5, nm_approx_vec) + correction +
+            0.000325 * extra.angle.sin + sum;
+        out[i] = t - ephemeris_correction_in(&year, t);
+
+        sweep_next(&solar);
+        sweep_next(&lunar);
+        sweep_next(&moon);
+        sweep_next(&omega);
+        sweep_next(&extra);
+    }
+}
+
+/* The lunation whose mean new moon is at or before t. The true new moon
+   is within a day or so of the mean one (ΔT included), so this is the
+   right lunation, or the one next to it. */
+static int mean_lunation(double t)
+{
+    return (int)floor((t - (nm_approx_vec[0] - 24724 * MEAN_SYNODIC_MONTH)) /
+                      MEAN_SYNODIC_MONTH);
+}
+
 double new_moon_before(double t)
 {
-    double jd = jd_from_moment(t);
-    int n = (int)round(t / MEAN_SYNODIC_MONTH - phase(jd, NULL,NULL,NULL,NULL,NULL,NULL));
-    return nth_new_moon(n);
+    PROFILE_FUNCTION(PROFILE_NEW_MOON_BEFORE);
+    int n = mean_lunation(t);
+    double m = nth_new_moon(n);
+    /* The estimate can be a lunation off when t is close to a new moon.
+       No lunation is shorter than SHORTEST_LUNATION, so the next new
+       moon only needs checking when m is further back than that. */
+    while (m >= t) m = nth_new_moon(--n);
+    while (t - m > SHORTEST_LUNATION) {
+        double next = nth_new_moon(n + 1);
+        if (next >= t) break;
+        m = next;
+        n++;
+    }
+    return m;
 }
 
 double new_moon_after(double t)
 {
-    double jd = jd_from_moment(t);
-    int n = (int)round(t / MEAN_SYNODIC_MONTH - phase(jd, NULL,NULL,NULL,NULL,NULL,NULL));
-    return nth_new_moon(n + 1);
+    PROFILE_FUNCTION(PROFILE_NEW_MOON_AFTER);
+    int n = mean_lunation(t) + 1;
+    double m = nth_new_moon(n);
+    while (m < t) m = nth_new_moon(++n);
+    while (m - t > SHORTEST_LUNATION) {
+        double prev = nth_new_moon(n - 1);
+        if (prev < t) break;
+        m = prev;
+        n--;
+    }
+    return m;
 }
 
 struct Zodiac Zodiacs[] = {
@@ -1114,6 +1430,211 @@ int current_zodiac(int date)
     return amod(floor(s / 30.0), 12);
 }
 
+#pragma mark Lunar
+
+/* Mean longitude, elongation, anomalies and argument of latitude of the
+   moon, as polynomials in Julian centuries (Meeus ch. 47). */
+static double lunar_mean_vec[] = { 218.3164477, 481267.88123421, -0.0015786,
+        1.0 / 538841, -1.0 / 65194000 };
+static double lunar_elongation_vec[] = { 297.8501921, 445267.1114034, -0.0018819,
+        1.0 / 545868, -1.0 / 113065000 };
+static double lunar_solaranom_vec[] = { 357.5291092, 35999.0502909, -0.0001536,
+        1.0 / 24490000 };
+static double lunar_lunaranom_vec[] = { 134.9633964, 477198.8675055, 0.0087414,
+        1.0 / 69699, -1.0 / 14712000 };
+static double lunar_node_vec[] = { 93.2720950, 483202.0175233, -0.0036539,
+        -1.0 / 3526000, 1.0 / 863310000 };
+
+static int ll_d_vec[] = { 0, 2, 2, 0, 0, 0, 2, 2, 2, 2, 0, 1, 0, 2, 0, 0, 4, 0, 4, 2,
+        2, 1, 1, 2, 2, 4, 2, 0, 2, 2, 1, 2, 0, 0, 2, 2, 2, 4, 0, 3, 2, 4, 0, 2,
+        2, 2, 4, 0, 4, 1, 2, 0, 1, 3, 4, 2, 0, 1, 2 };
+static int ll_m_vec[] = { 0, 0, 0, 0, 1, 0, 0, -1, 0, -1, 1, 0, 1, 0, 0, 0, 0, 0, 0,
+        1, 1, 0, 1, -1, 0, 0, 0, 1, 0, -1, 0, -2, 1, 2, -2, 0, 0, -1, 0, 0, 1,
+        -1, 2, 2, 1, -1, 0, 0, -1, 0, 1, 0, 1, 0, 0, -1, 2, 1, 0 };
+static int ll_mp_vec[] = { 1, -1, 0, 2, 0, 0, -2, -1, 1, 0, -1, 0, 1, 0, 1, 1, -1, 3,
+        -2, -1, 0, -1, 0, 1, 2, 0, -3, -2, -1, -2, 1, 0, 2, 0, -1, 1, 0, -1, 2,
+        -1, 1, -2, -1, -1, -2, 0, 1, 4, 0, -2, 0, 2, 1, -2, -3, 2, 1, -1, 3 };
+static int ll_f_vec[] = { 0, 0, 0, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, -2, 2, -2, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 0, 0, 0, -2, 2, 0, 2, 0, 0, 0, 0,
+        0, 0, -2, 0, 0, 0, 0, -2, -2, 0, 0, 0, 0, 0, 0, 0 };
+static int ll_coef_vec[] = { 6288774, 1274027, 658314, 213618, -185116, -114332,
+        58793, 57066, 53322, 45758, -40923, -34720, -30383, 15327, -12528,
+        10980, 10675, 10034, 8548, -7888, -6766, -5163, 4987, 4036, 3994, 3861,
+        3665, -2689, -2602, 2390, -2348, 2236, -2120, -2069, 2048, -1773, -1595,
+        1215, -1110, -892, -810, 759, -713, -700, 691, 596, 549, 537, 520, -487,
+        -399, -381, 351, -340, 330, 327, -323, 299, 294 };
+static int ll_count = 59;
+
+static int lb_d_vec[] = { 0, 0, 0, 2, 2, 2, 2, 0, 2, 0, 2, 2, 2, 2, 2, 2, 2, 0, 4, 0,
+        0, 0, 1, 0, 0, 0, 1, 0, 4, 4, 0, 4, 2, 2, 2, 2, 0, 2, 2, 2, 2, 4, 2, 2,
+        0, 2, 1, 1, 0, 2, 1, 2, 0, 4, 4, 1, 4, 1, 4, 2 };
+static int lb_m_vec[] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, -1, 0, 0, 1, -1, -1, -1, 1,
+        0, 1, 0, 1, 0, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, -1, 0, 0, 0, 0, 1, 1, 0,
+        -1, -2, 0, 1, 1, 1, 1, 1, 0, -1, 1, 0, -1, 0, 0, 0, -1, -2 };
+static int lb_mp_vec[] = { 0, 1, 1, 0, -1, -1, 0, 2, 1, 2, 0, -2, 1, 0, -1, 0, -1,
+        -1, -1, 0, 0, -1, 0, 1, 1, 0, 0, 3, 0, -1, 1, -2, 0, 2, 1, -2, 3, 2, -3,
+        -1, 0, 0, 1, 0, 1, 1, 0, 0, -2, -1, 1, -2, 2, -2, -1, 1, 1, -1, 0, 0 };
+static int lb_f_vec[] = { 1, 1, -1, -1, 1, -1, 1, 1, -1, -1, -1, -1, 1, -1, 1, 1,
+        -1, -1, -1, 1, 3, 1, 1, 1, -1, -1, -1, 1, -1, 1, -3, 1, -3, -1, -1, 1,
+        -1, 1, -1, 1, 1, 1, 1, -1, 3, -1, -1, 1, -1, -1, 1, -1, 1, -1, -1, -1,
+        -1, -1, -1, 1 };
+static int lb_coef_vec[] = { 5128122, 280602, 277693, 173237, 55413, 46271, 32573,
+        17198, 9266, 8822, 8216, 4324, 4200, -3359, 2463, 2211, 2065, -1870,
+        1828, -1794, -1749, -1565, -1491, -1475, -1410, -1344, -1335, 1107,
+        1021, 833, 777, 671, 607, 596, 491, -451, 439, 422, 421, -366, -351,
+        331, 315, 302, -283, -229, 223, 223, -220, -220, -185, 181, -177, 176,
+        166, -164, 132, -119, 115, 107 };
+static int lb_count = 60;
+
+/* Longitude of the moon, in degrees, at moment t. */
+double lunar_longitude(double t)
+{
+    PROFILE_FUNCTION(PROFILE_LUNAR_LONGITUDE);
+    double c = julian_centuries(t);
+    double mean_moon = poly(c, 5, lunar_mean_vec);
+    double elongation = poly(c, 5, lunar_elongation_vec);
+    double solar_anomaly = poly(c, 4, lunar_solaranom_vec);
+    double lunar_anomaly = poly(c, 5, lunar_lunaranom_vec);
+    double moon_node = poly(c, 5, lunar_node_vec);
+    double E = poly(c, 3, nm_E_vec);
+    double correction = 0.0;
+    for (int i = 0; i < ll_count; i++) {
+        correction += ll_coef_vec[i] * pow(E, abs(ll_m_vec[i])) *
+            sin(deg2rad(ll_d_vec[i] * elongation +
+                        ll_m_vec[i] * solar_anomaly +
+                        ll_mp_vec[i] * lunar_anomaly +
+                        ll_f_vec[i] * moon_node));
+    }
+    correction *= 0.000001;
+    double venus = 0.003958 * sin(deg2rad(119.75 + c * 131.849));
+    double jupiter = 0.000318 * sin(deg2rad(53.09 + c * 479264.29));
+    double flat_earth = 0.001962 * sin(deg2rad(mean_moon - moon_node));
+    return mod(mean_moon + correction + venus + jupiter + flat_earth
+                + nuation(t), 360);
+}
+
+/* Latitude of the moon, in degrees, at moment t. */
+double lunar_latitude(double t)
+{
+    PROFILE_FUNCTION(PROFILE_LUNAR_LATITUDE);
+    double c = julian_centuries(t);
+    double mean_moon = poly(c, 5, lunar_mean_vec);
+    double elongation = poly(c, 5, lunar_elongation_vec);
+    double solar_anomaly = poly(c, 4, lunar_solaranom_vec);
+    double lunar_anomaly = poly(c, 5, lunar_lunaranom_vec);
+    double moon_node = poly(c, 5, lunar_node_vec);
+    double E = poly(c, 3, nm_E_vec);
+    double latitude = 0.0;
+    for (int i = 0; i < lb_count; i++) {
+        latitude += lb_coef_vec[i] * pow(E, abs(lb_m_vec[i])) *
+            sin(deg2rad(lb_d_vec[i] * elongation +
+                        lb_m_vec[i] * solar_anomaly +
+                        lb_mp_vec[i] * lunar_anomaly +
+                        lb_f_vec[i] * moon_node));
+    }
+    latitude *= 0.000001;
+    double venus = 0.000175 * (sin(deg2rad(119.75 + c * 131.849 + moon_node)) +
+                               sin(deg2rad(119.75 + c * 131.849 - moon_node)));
+    double flat_earth = -0.002235 * sin(deg2rad(mean_moon))
+                        + 0.000127 * sin(deg2rad(mean_moon - lunar_anomaly))
+                        - 0.000115 * sin(deg2rad(mean_moon + lunar_anomaly));
+    double extra = 0.000382 * sin(deg2rad(313.45 + c * 481266.484));
+    return latitude + venus + flat_earth + extra;
+}
+
+/* Angle between the moon and the sun: 0 is new, 90 first quarter,
+   180 full, 270 last quarter. */
+double lunar_phase(double t)
+{
+    return mod(lunar_longitude(t) - solar_longitude(t), 360);
+}
+
+/* The moment near tau when the lunar phase is phi, by the secant method.
+   The phase gains 360 degrees a mean synodic month, give or take a
+   fifth, which makes the first step. */
+static double lunar_phase_near(double phi, double tau)
+{
+    double t0 = tau;
+    double f0 = mod(phi - lunar_phase(t0) + 180, 360) - 180;
+    double t1 = t0 + f0 * MEAN_SYNODIC_MONTH / 360;
+    for (int i = 0; i < 20 && fabs(t1 - t0) > 1e-6; i++) {
+        double f1 = mod(phi - lunar_phase(t1) + 180, 360) - 180;
+        if (f1 == f0) break;
+        double t2 = t1 + f1 * (t1 - t0) / (f0 - f1);
+        t0 = t1;
+        f0 = f1;
+        t1 = t2;
+    }
+    return t1;
+}
+
+double lunar_phase_at_or_before(double phi, double t)
+{
+    double tau = t - MEAN_SYNODIC_MONTH / 360 * mod(lunar_phase(t) - phi, 360);
+    tau = lunar_phase_near(phi, tau);
+    if (tau > t) tau = lunar_phase_near(phi, tau - MEAN_SYNODIC_MONTH);
+    return tau;
+}
+
+double lunar_phase_at_or_after(double phi, double t)
+{
+    double tau = t + MEAN_SYNODIC_MONTH / 360 * mod(phi - lunar_phase(t), 360);
+    tau = lunar_phase_near(phi, tau);
+    if (tau < t) tau = lunar_phase_near(phi, tau + MEAN_SYNODIC_MONTH);
+    return tau;
+}
+
+/* Quarter 0 is the new moon itself, then first quarter, full moon and
+   last quarter. */
+double nth_lunar_quarter(int n, int quarter)
+{
+    if (quarter == 0) return nth_new_moon(n);
+    double mean = nm_approx_vec[0] - 24724 * MEAN_SYNODIC_MONTH +
+                    (n + quarter / 4.0) * MEAN_SYNODIC_MONTH;
+    return lunar_phase_near(90 * quarter, mean);
+}
+
+/* Mean sidereal time of Greenwich, in degrees, at universal moment t. */
+static double sidereal_vec[] = { 280.46061837, 36525 * 360.98564736629,
+        0.000387933, -1.0 / 38710000 };
+double sidereal_from_moment(double t)
+{
+    double c = (t - 730120.5) / 36525;
+    return mod(poly(c, 4, sidereal_vec), 360);
+}
+
+/* Equatorial coordinates of a body at ecliptic latitude beta
+   and longitude lambda. */
+double declination(double t, double beta, double lambda)
+{
+    double e = deg2rad(obliquity(t));
+    double b = deg2rad(beta);
+    double l = deg2rad(lambda);
+    return rad2deg(asin(sin(b) * cos(e) + cos(b) * sin(e) * sin(l)));
+}
+
+double right_ascension(double t, double beta, double lambda)
+{
+    double e = deg2rad(obliquity(t));
+    double b = deg2rad(beta);
+    double l = deg2rad(lambda);
+    return mod(rad2deg(atan2(sin(l) * cos(e) - tan(b) * sin(e), cos(l))), 360);
+}
+
+/* Geocentric altitude of the moon above the horizon, in degrees. */
+double lunar_altitude(double t, struct Locale locale)
+{
+    double phi = deg2rad(locale.latitude);
+    double lambda = lunar_longitude(t);
+    double beta = lunar_latitude(t);
+    double alpha = right_ascension(t, beta, lambda);
+    double delta = deg2rad(declination(t, beta, lambda));
+    double H = deg2rad(mod(sidereal_from_moment(t) + locale.longitude - alpha, 360));
+    double altitude = rad2deg(asin(sin(phi) * sin(delta) +
+                                   cos(phi) * cos(delta) * cos(H)));
+    return mod(altitude + 180, 360) - 180;
+}
+
 #pragma mark Time
 
 /* "local" is local mean time, not the local timezone */
@@ -1185,3 +1706,211 @@ double equation_of_time(double t)
                 -1.25 * eccentricity * eccentricity * sin(deg2rad(2 * anomaly)));
     return signum(eq) * fmin(fabs(eq), 0.5);
 }
+
+double apparent_from_local(double t, struct Locale locale)
+{
+    return t + equation_of_time(universal_from_local(t, locale));
+}
+
+double local_from_apparent(double t, struct Locale locale)
+{
+    return t - equation_of_time(universal_from_local(t, locale));
+}
+
+#pragma mark Sunrise and Sunset
+
+/* Refraction angle at the horizon, including the dip for elevation. */
+static double refraction(struct Locale locale)
+{
+    double h = fmax(0, locale.elevation);
+    double R = 6.372e6;
+    double dip = rad2deg(acos(R / (R + h)));
+    return angle(0, 34, 0) + dip + angle(0, 0, 19) * sqrt(h);
+}
+
+static double sine_offset(double t, struct Locale locale, double alpha)
+{
+    double phi = deg2rad(locale.latitude);
+    double tu = universal_from_local(t, locale);
+    double delta = deg2rad(declination(tu, 0, solar_longitude(tu)));
+    return tan(phi) * tan(delta) + sin(deg2rad(alpha)) / (cos(delta) * cos(phi));
+}
+
+/* Returns NAN if the sun never gets alpha degrees below the horizon. */
+static double approx_moment_of_depression(double t, struct Locale locale,
+                                          double alpha, bool early)
+{
+    double try = sine_offset(t, locale, alpha);
+    double date = floor(t);
+    double alt;
+    if (alpha >= 0) alt = early ? date : date + 1;
+    else alt = date + 0.5;
+    double value = fabs(try) > 1 ? sine_offset(alt, locale, alpha) : try;
+    if (fabs(value) > 1) return NAN;
+    double offset = mod(rad2deg(asin(value)) / 360 + 0.5, 1) - 0.5;
+    return local_from_apparent(date + (early ? 0.25 - offset : 0.75 + offset),
+                               locale);
+}
+
+static double moment_of_depression(double approx, struct Locale locale,
+                                   double alpha, bool early)
+{
+    double t = approx_moment_of_depression(approx, locale, alpha, early);
+    if (isnan(t)) return NAN;
+    if (fabs(approx - t) < 30.0 / (24 * 60 * 60)) return t;
+    return moment_of_depression(t, locale, alpha, early);
+}
+
+/* Standard time in the morning of date when the sun is alpha degrees
+   below the horizon. NAN if it never happens. */
+double dawn(int date, struct Locale locale, double alpha)
+{
+    double t = moment_of_depression(date + 0.25, locale, alpha, true);
+    return isnan(t) ? NAN : standard_from_local(t, locale);
+}
+
+/* Standard time in the evening of date when the sun is alpha degrees
+   below the horizon. NAN if it never happens. */
+double dusk(int date, struct Locale locale, double alpha)
+{
+    double t = moment_of_depression(date + 0.75, locale, alpha, false);
+    return isnan(t) ? NAN : standard_from_local(t, locale);
+}
+
+double sunrise(int date, struct Locale locale)
+{
+    double alpha = refraction(locale) + angle(0, 16, 0);
+    return dawn(date, locale, alpha);
+}
+
+double sunset(int date, struct Locale locale)
+{
+    double alpha = refraction(locale) + angle(0, 16, 0);
+    return dusk(date, locale, alpha);
+}
+
+#pragma mark Observational Islamic
+
+/* The book uses Cairo. */
+struct Locale IslamicLocation = { 30.1, 31.3, 200, 2 };
+
+/* True if the crescent moon is visible on the evening before date
+   (the start of the Islamic day), by Shaukat's criterion. */
+bool visible_crescent(int date, struct Locale locale)
+{
+    double d = dusk(date - 1, locale, 4.5);
+    if (isnan(d)) return false;
+    double t = universal_from_standard(d, locale);
+    double phase = lunar_phase(t);
+    if (!(0 < phase && phase < 90)) return false;
+    double arc_of_light = rad2deg(acos(cos(deg2rad(lunar_latitude(t))) *
+                                       cos(deg2rad(phase))));
+    if (arc_of_light < 10.6 || arc_of_light > 90) return false;
+    return lunar_altitude(t, locale) > 4.1;
+}
+
+/* Closest fixed date on or before date when the crescent moon
+   first became visible at locale. */
+int phasis_on_or_before(int date, struct Locale locale)
+{
+    PROFILE_FUNCTION(PROFILE_PHASIS_ON_OR_BEFORE);
+    int moon = (int)floor(new_moon_before(date + 1));
+    int age = date - moon;
+    int tau = (age <= 3 && !visible_crescent(date, locale)) ? moon - 30 : moon;
+    int d = tau;
+    while (!visible_crescent(d, locale)) {
+        PROFILE_ITERATION(PROFILE_PHASIS_ON_OR_BEFORE);
+        d++;
+    }
+    return d;
+}
+
+/* First day of the month that begins elapsed_months after the epoch. */
+int observational_islamic_month_start(int elapsed_months, struct Locale locale)
+{
+    int midmonth = EPOCH_ISLAMIC +
+            (int)floor((elapsed_months + 0.5) * MEAN_SYNODIC_MONTH);
+    return phasis_on_or_before(midmonth, locale);
+}
+
+void observational_islamic_from_fixed(int date, struct Locale locale,
+                                      int *ryear, int *rmonth, int *rday)
+{
+    int crescent = phasis_on_or_before(date, locale);
+    int elapsed_months = (int)round((crescent - EPOCH_ISLAMIC) / MEAN_SYNODIC_MONTH);
+    int year = (int)floor(elapsed_months / 12.0) + 1;
+    int month = (int)mod(elapsed_months, 12) + 1;
+    int day = date - crescent + 1;
+
+    if (ryear) *ryear = year;
+    if (rmonth) *rmonth = month;
+    if (rday) *rday = day;
+}
+
+int fixed_from_observational_islamic(int year, int month, int day,
+                                     struct Locale locale)
+{
+    return observational_islamic_month_start((year - 1) * 12 + month - 1, locale)
+            + day - 1;
+}
+
+#pragma mark Persian
+
+struct Locale TehranLocation = { 35.68, 51.42, 1100, 3.5 };
+
+/* Standard time of true (apparent) noon on date at locale. */
+double midday(int date, struct Locale locale)
+{
+    return standard_from_local(local_from_apparent(date + 0.5, locale), locale);
+}
+
+double midday_in_tehran(int date)
+{
+    return universal_from_standard(midday(date, TehranLocation), TehranLocation);
+}
+
+/* Fixed date of the Persian new year on or before date: the day in
+   whose Tehran noon the sun has passed the vernal equinox. */
+int persian_new_year_on_or_before(int date)
+{
+    double approx = estimate_prior_solar_longitude(midday_in_tehran(date),
+                                                   LONGITUDE_SPRING);
+    int day = (int)floor(approx) - 1;
+    while (solar_longitude(midday_in_tehran(day)) > LONGITUDE_SPRING + 2) day++;
+    return day;
+}
+
+/* The new year of year, as fixed_from_persian(year, 1, 1). */
+int persian_new_year(int year)
+{
+    int y = year > 0 ? year - 1 : year;     /* no year 0 */
+    return persian_new_year_on_or_before(EPOCH_PERSIAN + 180 +
+                                         (int)floor(MEAN_TROPICAL_YEAR * y));
+}
+
+/* Day of the year of the first of month: six months of 31 days, then
+   five of 30, then Esfand of 29 or 30. */
+static int persian_month_offset(int month)
+{
+    return month <= 7 ? 31 * (month - 1) : 30 * (month - 1) + 6;
+}
+
+void persian_from_fixed(int date, int *ryear, int *rmonth, int *rday)
+{
+    int new_year = persian_new_year_on_or_before(date);
+    int y = (int)round((new_year - EPOCH_PERSIAN) / MEAN_TROPICAL_YEAR) + 1;
+    int year = y > 0 ? y : y - 1;
+    int day_of_year = date - new_year + 1;
+    int month = day_of_year <= 186 ? (int)ceil(day_of_year / 31.0)
+                                   : (int)ceil((day_of_year - 6) / 30.0);
+    int day = day_of_year - persian_month_offset(month);
+
+    if (ryear) *ryear = year;
+    if (rmonth) *rmonth = month;
+    if (rday) *rday = day;
+}
+
+int fixed_from_persian(int year, int month, int day)
+{
+    return persian_new_year(year) + persian_month_offset(month) + day - 1;
+}
@@ -0,0 +1,637 @@
+/*
+ *  calendar.hpp
+ *  Value types for C++, with constexpr conversions for the arithmetic
+ *  calendars.
+ *
+ *  The arithmetic conversions are written out here in integer arithmetic
+ *  so that they can run at compile time; they give the same results as
+ *  the C functions of the same names. The calendars of fixed months in a
+ *  cycle of leap years share one template, which also gives the Coptic,
+ *  Ethiopic, arithmetic Persian and other tabular Islamic calendars. The
+ *  Chinese calendar needs the astronomy, so it calls into the library.
+ *
+ *  With C++20 there are conversions to and from std::chrono::sys_days
+ *  and year_month_day too.
+ *
+ *  Needs C++14.
+ */
+
+#ifndef CALENDAR_HPP
+#define CALENDAR_HPP
+
+#include <chrono>
+#include <cstddef>
+#include "calendar.h"
+
+static_assert(__cplusplus >= 201402L, "calendar.hpp needs C++14");
+
+namespace calendrical {
+
+namespace detail {
+
+/* Floor division and modulus, for a positive divisor. */
+constexpr long long quotient(long long x, long long y) noexcept
+{
+    return x / y - (x % y < 0);
+}
+
+constexpr int mod(long long x, int y) noexcept
+{
+    return (int)(x - quotient(x, y) * y);
+}
+
+}
+
+/* A fixed date: day 1 is January 1, AD 1 (Gregorian). */
+struct RataDie {
+    int value;
+
+    constexpr RataDie() noexcept : value(0) {}
+    constexpr explicit RataDie(int date) noexcept : value(date) {}
+
+    constexpr RataDie &operator+=(int days) noexcept { value += days; return *this; }
+    constexpr RataDie &operator-=(int days) noexcept { value -= days; return *this; }
+};
+
+constexpr RataDie operator+(RataDie date, int days) noexcept { return RataDie(date.value + days); }
+constexpr RataDie operator-(RataDie date, int days) noexcept { return RataDie(date.value - days); }
+constexpr int operator-(RataDie a, RataDie b) noexcept { return a.value - b.value; }
+constexpr bool operator==(RataDie a, RataDie b) noexcept { return a.value == b.value; }
+constexpr bool operator!=(RataDie a, RataDie b) noexcept { return a.value != b.value; }
+constexpr bool operator<(RataDie a, RataDie b) noexcept { return a.value < b.value; }
+constexpr bool operator<=(RataDie a, RataDie b) noexcept { return a.value <= b.value; }
+constexpr bool operator>(RataDie a, RataDie b) noexcept { return a.value > b.value; }
+constexpr bool operator>=(RataDie a, RataDie b) noexcept { return a.value >= b.value; }
+
+/* Arithmetic calendars
+ *
+ * The Gregorian, Julian, tabular Islamic, Coptic, Ethiopic and arithmetic
+ * Persian calendars are all years of fixed months, with a leap day added
+ * to one month in the leap years of a cycle. They differ only in those
+ * things, so ArithmeticDate<Rules> is a date in any of them and one set of
+ * conversions serves them all. Rules says:
+ *   Years:  static constexpr functions giving whether a year is a leap
+ *           year, the days from the epoch to its first day, and the year
+ *           a count of days from the epoch falls in
+ *   Months: the month lengths of a common year, and the month that gets
+ *           the leap day
+ *   epoch:  the fixed date of the first day of year 1
+ * The days before each month and the month of each day of the year are
+ * tables made at compile time, so a conversion is integer arithmetic on
+ * the year and a lookup, with no branching on the month.
+ *
+ * Most leap-year rules spread a leap years evenly over a cycle of c years,
+ * making year y a leap year when (a y + b) mod c < a; UniformYears works
+ * the rest out from a, b and c. Months past the ends of the year carry
+ * into the years either side. */
+
+template <class Rules>
+struct ArithmeticDate {
+    using rules = Rules;
+    int year;
+    int month;
+    int day;
+};
+
+template <class Rules>
+constexpr bool operator==(ArithmeticDate<Rules> x, ArithmeticDate<Rules> y) noexcept
+{
+    return x.year == y.year && x.month == y.month && x.day == y.day;
+}
+
+template <class Rules>
+constexpr bool operator!=(ArithmeticDate<Rules> x, ArithmeticDate<Rules> y) noexcept
+{
+    return !(x == y);
+}
+
+template <class Years, class Months, int Epoch>
+struct ArithmeticRules {
+    using years = Years;
+    using months = Months;
+    static constexpr int epoch = Epoch;
+};
+
+namespace detail {
+
+/* Base days a year, and a leap years in c: year y is a leap year when
+   (a y + b) mod c < a. The leap years up to y are then
+   floor((a y + b) / c) - floor(b / c), which inverts exactly. */
+template <int Base, int A, int B, int C, bool NoYearZero = false>
+struct UniformYears {
+    static constexpr long long count(int year) noexcept
+    {
+        return NoYearZero && year < 0 ? year + 1 : year;
+    }
+
+    static constexpr bool leap(int year) noexcept
+    {
+        return mod(A * count(year) + B, C) < A;
+    }
+
+    static constexpr long long start(int year) noexcept
+    {
+        return Base * (count(year) - 1) + quotient(A * (count(year) - 1) + B, C) -
+            quotient(B, C);
+    }
+
+    static constexpr int year(long long days) noexcept
+    {
+        int y = (int)(1 + quotient(C * days + C * (quotient(B, C) + 1) - B - 1,
+                                   (long long)Base * C + A));
+        return NoYearZero && y <= 0 ? y - 1 : y;
+    }
+};
+
+/* 97 leap years in 400, by centuries. */
+struct GregorianYears {
+    static constexpr bool leap(int year) noexcept
+    {
+        return mod(year, 4) == 0 &&
+            mod(year, 400) != 100 && mod(year, 400) != 200 && mod(year, 400) != 300;
+    }
+
+    static constexpr long long start(int year) noexcept
+    {
+        long long y = year - 1LL;
+        return 365 * y + quotient(y, 4) - quotient(y, 100) + quotient(y, 400);
+    }
+
+    static constexpr int year(long long days) noexcept
+    {
+        int n400 = (int)quotient(days, 146097);
+        int d1 = mod(days, 146097);
+        int n100 = d1 / 36524;
+        int d2 = d1 % 36524;
+        int n4 = d2 / 1461;
+        int n1 = d2 % 1461 / 365;
+        int year = 400 * n400 + 100 * n100 + 4 * n4 + n1;
+        return n100 == 4 || n1 == 4 ? year : year + 1;
+    }
+};
+
+/* 683 leap years in a 2820-year cycle starting in AP 475, spread evenly
+   within it, with no year 0. */
+struct ArithmeticPersianYears {
+    static constexpr long long cycle_year(int year) noexcept
+    {
+        return year > 0 ? year - 474LL : year - 473LL;
+    }
+
+    static constexpr bool leap(int year) noexcept
+    {
+        return mod((mod(cycle_year(year), 2820) + 474 + 38) * 682LL, 2816) < 682;
+    }
+
+    static constexpr long long start(int year) noexcept
+    {
+        long long y = cycle_year(year);
+        long long x = mod(y, 2820) + 474;
+        return 1029983 * quotient(y, 2820) + 365 * (x - 1) + quotient(682 * x - 110, 2816);
+    }
+
+    static constexpr int year(long long days) noexcept
+    {
+        long long d0 = days - 173125;           /* start(475) */
+        long long n2820 = quotient(d0, 1029983);
+        int d1 = mod(d0, 1029983);
+        long long y2820 = d1 == 1029982 ? 2820 : quotient(2816LL * d1 + 1031337, 1028522);
+        long long year = 474 + 2820 * n2820 + y2820;
+        return (int)(year > 0 ? year : year - 1);
+    }
+};
+
+template <int LeapMonth, int... Lengths>
+struct Months {
+    static constexpr int count = sizeof...(Lengths);
+    static constexpr int leap_month = LeapMonth;
+
+    static constexpr int length(int month) noexcept
+    {
+        const int lengths[] = { Lengths... };
+        return lengths[month - 1];
+    }
+};
+
+/* Indexed by whether it's a leap year. before[m] is the days of the year
+   before month m, and before[count + 1] the days in the year. */
+struct MonthTable {
+    int before[2][15];
+    unsigned char month[2][367];
+};
+
+template <class M>
+constexpr MonthTable month_table() noexcept
+{
+    static_assert(M::count <= 13, "at most 13 months");
+    MonthTable table{};
+    for (int leap = 0; leap < 2; leap++) {
+        int day = 0;
+        for (int m = 1; m <= M::count; m++) {
+            int length = M::length(m) + (leap && m == M::leap_month);
+            table.before[leap][m] = day;
+            for (int i = 0; i < length; i++) table.month[leap][day + i] = (unsigned char)m;
+            day += length;
+        }
+        table.before[leap][M::count + 1] = day;
+    }
+    return table;
+}
+
+template <class M>
+struct MonthTableOf {
+    static constexpr MonthTable value = month_table<M>();
+};
+
+template <class M>
+constexpr MonthTable MonthTableOf<M>::value;
+
+using JulianMonths = Months<2, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31>;
+using IslamicMonths = Months<12, 30, 29, 30, 29, 30, 29, 30, 29, 30, 29, 30, 29>;
+using CopticMonths = Months<13, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 5>;
+using PersianMonths = Months<12, 31, 31, 31, 31, 31, 31, 30, 30, 30, 30, 30, 29>;
+
+}
+
+using GregorianRules = ArithmeticRules<detail::GregorianYears, detail::JulianMonths, 1>;
+using JulianRules = ArithmeticRules<detail::UniformYears<365, 1, 0, 4, true>,
+                                    detail::JulianMonths, -1>;
+
+/* The tabular Islamic calendars differ in which eleven years of the 30
+   are leap years, by b, and some in the epoch. */
+template <int B, int Epoch = 227015>       /* EPOCH_ISLAMIC, July 16, 622 (Julian) */
+using TabularIslamicRules = ArithmeticRules<detail::UniformYears<354, 11, B, 30>,
+                                            detail::IslamicMonths, Epoch>;
+
+using GregorianDate = ArithmeticDate<GregorianRules>;
+using JulianDate = ArithmeticDate<JulianRules>;                      /* no year 0 */
+/* leap years 2, 5, 7, 10, 13, 16, 18, 21, 24, 26 and 29 */
+using IslamicDate = ArithmeticDate<TabularIslamicRules<14>>;
+/* the same with 15 for 16 */
+using Islamic15Date = ArithmeticDate<TabularIslamicRules<15>>;
+/* 2, 5, 8, 10, 13, 16, 19, 21, 24, 27 and 29, from the Thursday before,
+   as the Bohras reckon */
+using BohraIslamicDate = ArithmeticDate<TabularIslamicRules<11, 227014>>;
+/* Twelve months of 30 days, then 5 or 6 epagomenal days as month 13.
+   Years count from August 29, 284 (Julian) and 8 respectively. */
+using CopticDate = ArithmeticDate<ArithmeticRules<detail::UniformYears<365, 1, 1, 4>,
+                                                  detail::CopticMonths, 103605>>;
+using EthiopicDate = ArithmeticDate<ArithmeticRules<detail::UniformYears<365, 1, 1, 4>,
+                                                    detail::CopticMonths, 2796>>;
+/* From March 19, 622 (Julian); no year 0 */
+using ArithmeticPersianDate = ArithmeticDate<ArithmeticRules<detail::ArithmeticPersianYears,
+                                                             detail::PersianMonths, 226896>>;
+
+struct HebrewDate { int year; int month; int day; };        /* Nisan is 1 */
+struct IsoDate { int year; int week; int day; };            /* Monday 1 to Sunday 7 */
+struct MayanLongCount { int baktun; int katun; int tun; int uinal; int kin; };
+using ChineseDate = ::ChineseDate;
+
+#define CALENDRICAL_FIELDS_EQUAL(T, a, b, c) \
+    constexpr bool operator==(T x, T y) noexcept \
+        { return x.a == y.a && x.b == y.b && x.c == y.c; } \
+    constexpr bool operator!=(T x, T y) noexcept { return !(x == y); }
+
+CALENDRICAL_FIELDS_EQUAL(HebrewDate, year, month, day)
+CALENDRICAL_FIELDS_EQUAL(IsoDate, year, week, day)
+
+#undef CALENDRICAL_FIELDS_EQUAL
+
+constexpr bool operator==(MayanLongCount x, MayanLongCount y) noexcept
+{
+    return x.baktun == y.baktun && x.katun == y.katun && x.tun == y.tun &&
+        x.uinal == y.uinal && x.kin == y.kin;
+}
+constexpr bool operator!=(MayanLongCount x, MayanLongCount y) noexcept { return !(x == y); }
+
+/* Sunday is 0 */
+constexpr int day_of_week(RataDie date) noexcept
+{
+    return detail::mod(date.value, 7);
+}
+
+constexpr RataDie kday_on_or_before(RataDie date, int k) noexcept
+{
+    return date - detail::mod(date.value - k, 7);
+}
+
+constexpr RataDie kday_on_or_after(RataDie date, int k) noexcept { return kday_on_or_before(date + 6, k); }
+constexpr RataDie kday_nearest(RataDie date, int k) noexcept { return kday_on_or_before(date + 3, k); }
+constexpr RataDie kday_before(RataDie date, int k) noexcept { return kday_on_or_before(date - 1, k); }
+constexpr RataDie kday_after(RataDie date, int k) noexcept { return kday_on_or_before(date + 7, k); }
+
+/* Arithmetic calendars: for D any ArithmeticDate */
+
+template <class D>
+constexpr bool leap_year(int year) noexcept
+{
+    return D::rules::years::leap(year);
+}
+
+template <class D>
+constexpr int last_day_of_month(int month, int year) noexcept
+{
+    using months = typename D::rules::months;
+    return month < 1 || month > months::count ? 0 :
+        months::length(month) + (month == months::leap_month && leap_year<D>(year));
+}
+
+template <class Rules>
+constexpr RataDie fixed_from(ArithmeticDate<Rules> date) noexcept
+{
+    using months = typename Rules::months;
+    const detail::MonthTable &table = detail::MonthTableOf<months>::value;
+    int year = date.year, month = date.month;
+    if (month < 1 || month > months::count) {
+        year += (int)detail::quotient(month - 1, months::count);
+        month = detail::mod(month - 1, months::count) + 1;
+    }
+    return RataDie((int)(Rules::epoch + Rules::years::start(year) +
+        table.before[Rules::years::leap(year)][month] + date.day - 1));
+}
+
+namespace detail {
+
+template <class D>
+constexpr D arithmetic_from_fixed(RataDie date) noexcept
+{
+    using rules = typename D::rules;
+    const MonthTable &table = MonthTableOf<typename rules::months>::value;
+    long long days = (long long)date.value - rules::epoch;
+    int year = rules::years::year(days);
+    int day_of_year = (int)(days - rules::years::start(year));
+    bool leap = rules::years::leap(year);
+    int month = table.month[leap][day_of_year];
+    return D{year, month, day_of_year - table.before[leap][month] + 1};
+}
+
+}
+
+/* Many at once, in loops the compiler can unroll and vectorize. */
+template <class Rules>
+void from_fixed_n(const int *dates, ArithmeticDate<Rules> *results, std::size_t n) noexcept
+{
+    for (std::size_t i = 0; i < n; i++)
+        results[i] = detail::arithmetic_from_fixed<ArithmeticDate<Rules>>(RataDie(dates[i]));
+}
+
+template <class Rules>
+void fixed_from_n(const ArithmeticDate<Rules> *dates, int *results, std::size_t n) noexcept
+{
+    for (std::size_t i = 0; i < n; i++) results[i] = fixed_from(dates[i]).value;
+}
+
+/* Gregorian */
+
+constexpr bool gregorian_leap_year(int year) noexcept
+{
+    return leap_year<GregorianDate>(year);
+}
+
+constexpr int last_day_of_gregorian_month(int month, int year) noexcept
+{
+    return last_day_of_month<GregorianDate>(month, year);
+}
+
+constexpr int gregorian_year_from_fixed(RataDie date) noexcept
+{
+    return detail::GregorianYears::year(date.value - 1LL);
+}
+
+constexpr GregorianDate gregorian_from_fixed(RataDie date) noexcept
+{
+    return detail::arithmetic_from_fixed<GregorianDate>(date);
+}
+
+/* Negative values of n count back from the end of the month. */
+constexpr RataDie nth_kday_in_month(int n, int k, int year, int month) noexcept
+{
+    return n > 0 ?
+        kday_on_or_before(fixed_from(GregorianDate{year, month, 7}), k) + 7 * (n - 1) :
+        kday_on_or_before(fixed_from(GregorianDate{year, month,
+            last_day_of_gregorian_month(month, year)}), k) + 7 * (1 + n);
+}
+
+/* Julian */
+
+constexpr bool julian_leap_year(int year) noexcept
+{
+    return leap_year<JulianDate>(year);
+}
+
+constexpr JulianDate julian_from_fixed(RataDie date) noexcept
+{
+    return detail::arithmetic_from_fixed<JulianDate>(date);
+}
+
+/* Islamic */
+
+constexpr bool islamic_leap_year(int year) noexcept
+{
+    return leap_year<IslamicDate>(year);
+}
+
+constexpr IslamicDate islamic_from_fixed(RataDie date) noexcept
+{
+    return detail::arithmetic_from_fixed<IslamicDate>(date);
+}
+
+/* Hebrew */
+
+constexpr bool hebrew_leap_year(int year) noexcept
+{
+    return detail::mod(1 + 7LL * year, 19) < 7;
+}
+
+constexpr int last_month_of_hebrew_year(int year) noexcept
+{
+    return hebrew_leap_year(year) ? 13 : 12;
+}
+
+constexpr int hebrew_calendar_elapsed_days(int year) noexcept
+{
+    long long months_elapsed = detail::quotient(235LL * year - 234, 19);
+    long long parts_elapsed = 12084 + 13753 * months_elapsed;
+    long long day = 29 * months_elapsed + detail::quotient(parts_elapsed, 25920);
+    return (int)(detail::mod(3 * (day + 1), 7) < 3 ? day + 1 : day);
+}
+
+constexpr int hebrew_new_year(int year) noexcept
+{
+    int ny0 = hebrew_calendar_elapsed_days(year - 1);
+    int ny1 = hebrew_calendar_elapsed_days(year);
+    int ny2 = hebrew_calendar_elapsed_days(year + 1);
+    return -1373427 + ny1 +         /* EPOCH_HEBREW */
+        (ny2 - ny1 == 356 ? 2 : ny1 - ny0 == 382 ? 1 : 0);
+}
+
+constexpr int days_in_hebrew_year(int year) noexcept
+{
+    return hebrew_new_year(year + 1) - hebrew_new_year(year);
+}
+
+constexpr int last_day_of_hebrew_month(int month, int year) noexcept
+{
+    return month == 2 || month == 4 || month == 6 || month == 10 || month == 13 ||
+        (month == 12 && !hebrew_leap_year(year)) ||
+        (month == 8 && days_in_hebrew_year(year) % 10 != 5) ||
+        (month == 9 && days_in_hebrew_year(year) % 10 == 3) ? 29 : 30;
+}
+
+constexpr RataDie fixed_from(HebrewDate h) noexcept
+{
+    int date = hebrew_new_year(h.year) + h.day - 1;
+    if (h.month < 7) {
+        for (int m = 7; m <= last_month_of_hebrew_year(h.year); m++)
+            date += last_day_of_hebrew_month(m, h.year);
+        for (int m = 1; m < h.month; m++)
+            date += last_day_of_hebrew_month(m, h.year);
+    } else {
+        for (int m = 7; m < h.month; m++)
+            date += last_day_of_hebrew_month(m, h.year);
+    }
+    return RataDie(date);
+}
+
+constexpr HebrewDate hebrew_from_fixed(RataDie date) noexcept
+{
+    int year = (int)detail::quotient(98496LL * (date.value + 1373427), 35975351);
+    while (hebrew_new_year(year) <= date.value) year++;
+    year--;
+
+    int month = date < fixed_from(HebrewDate{year, 1, 1}) ? 7 : 1;
+    while (date > fixed_from(HebrewDate{year, month, last_day_of_hebrew_month(month, year)}))
+        month++;
+    return HebrewDate{year, month, date - fixed_from(HebrewDate{year, month, 1}) + 1};
+}
+
+/* ISO */
+
+constexpr RataDie fixed_from(IsoDate i) noexcept
+{
+    /* nth_kday(week, 0, year - 1, 12, 28) + day */
+    RataDie dec28 = fixed_from(GregorianDate{i.year - 1, 12, 28});
+    return (i.week > 0 ? kday_before(dec28, 0) : kday_after(dec28, 0)) +
+        7 * i.week + i.day;
+}
+
+constexpr IsoDate iso_from_fixed(RataDie date) noexcept
+{
+    int approx = gregorian_year_from_fixed(date - 3);
+    int year = date >= fixed_from(IsoDate{approx + 1, 1, 1}) ? approx + 1 : approx;
+    int week = 1 + (int)detail::quotient(date - fixed_from(IsoDate{year, 1, 1}), 7);
+    int day = detail::mod(date.value - 1, 7) + 1;
+    return IsoDate{year, week, day};
+}
+
+/* Mayan */
+
+constexpr RataDie fixed_from(MayanLongCount m) noexcept
+{
+    return RataDie(-1137142 + m.baktun * 144000 + m.katun * 7200 +     /* EPOCH_MAYAN */
+        m.tun * 360 + m.uinal * 20 + m.kin);
+}
+
+constexpr MayanLongCount mayan_long_count_from_fixed(RataDie date) noexcept
+{
+    int long_count = date.value + 1137142;
+    int day_of_baktun = detail::mod(long_count, 144000);
+    int day_of_katun = day_of_baktun % 7200;
+    int day_of_tun = day_of_katun % 360;
+    return MayanLongCount{(int)detail::quotient(long_count, 144000),
+        day_of_baktun / 7200, day_of_katun / 360, day_of_tun / 20, day_of_tun % 20};
+}
+
+/* Chinese: not constexpr, this is astronomy. */
+
+inline RataDie fixed_from(ChineseDate c)
+{
+    return RataDie(::fixed_from_chinese(c));
+}
+
+inline ChineseDate chinese_from_fixed(RataDie date)
+{
+    ChineseDate c;
+    ::chinese_from_fixed(date.value, &c);
+    return c;
+}
+
+/* Any of the above to any other, by way of the fixed date. */
+
+constexpr RataDie fixed_from(RataDie date) noexcept { return date; }
+
+namespace detail {
+
+template <typename To> struct Cast;
+
+template <> struct Cast<RataDie> {
+    static constexpr RataDie from_fixed(RataDie d) noexcept { return d; }
+};
+template <class Rules> struct Cast<ArithmeticDate<Rules>> {
+    static constexpr ArithmeticDate<Rules> from_fixed(RataDie d) noexcept
+    {
+        return arithmetic_from_fixed<ArithmeticDate<Rules>>(d);
+    }
+};
+template <> struct Cast<HebrewDate> {
+    static constexpr HebrewDate from_fixed(RataDie d) noexcept { return hebrew_from_fixed(d); }
+};
+template <> struct Cast<IsoDate> {
+    static constexpr IsoDate from_fixed(RataDie d) noexcept { return iso_from_fixed(d); }
+};
+template <> struct Cast<MayanLongCount> {
+    static constexpr MayanLongCount from_fixed(RataDie d) noexcept
+    {
+        return mayan_long_count_from_fixed(d);
+    }
+};
+
+}
+
+template <typename To, typename From>
+constexpr To date_cast(From from) noexcept
+{
+    return detail::Cast<To>::from_fixed(fixed_from(from));
+}
+
+#if __cplusplus >= 202002L
+
+/* sys_days counts from the Unix epoch, RD 719163. */
+
+constexpr std::chrono::sys_days to_sys_days(RataDie date) noexcept
+{
+    return std::chrono::sys_days(std::chrono::days(date.value - 719163));
+}
+
+constexpr RataDie fixed_from(std::chrono::sys_days days) noexcept
+{
+    return RataDie((int)days.time_since_epoch().count() + 719163);
+}
+
+constexpr std::chrono::year_month_day to_year_month_day(GregorianDate g) noexcept
+{
+    return std::chrono::year_month_day(std::chrono::year(g.year),
+        std::chrono::month((unsigned)g.month), std::chrono::day((unsigned)g.day));
+}
+
+constexpr std::chrono::year_month_day to_year_month_day(RataDie date) noexcept
+{
+    return to_year_month_day(gregorian_from_fixed(date));
+}
+
+constexpr GregorianDate gregorian_from(std::chrono::year_month_day ymd) noexcept
+{
+    return GregorianDate{int(ymd.year()), (int)unsigned(ymd.month()),
+        (int)unsigned(ymd.day())};
+}
+
+constexpr RataDie fixed_from(std::chrono::year_month_day ymd) noexcept
+{
+    return fixed_from(gregorian_from(ymd));
+}
+
+#endif
+
+}
+
+#endif
@@ -0,0 +1,397 @@
+/*
+ *  calendar64.c
+ *  The arithmetic calendars over int64_t dates and years.
+ *
+ *  The same steps as calendar.c, in integer arithmetic throughout, so
+ *  that nothing is lost to doubles either. The largest product is the
+ *  Hebrew calendar's parts elapsed, 13753 times the months elapsed,
+ *  which stays below 2^63 for years short of 5 * 10^13.
+ */
+
+#include <math.h>
+#include "calendar64.h"
+
+#define EPOCH_HEBREW -1373427
+#define EPOCH_ISLAMIC 227015
+#define EPOCH_MAYAN -1137142
+
+/* Floor modulus and quotient, for a positive divisor. */
+static inline int64_t mod64(int64_t x, int64_t y)
+{
+    int64_t r = x % y;
+    return r < 0 ? r + y : r;
+}
+
+static inline int64_t quotient64(int64_t x, int64_t y)
+{
+    return (x - mod64(x, y)) / y;
+}
+
+static inline int amod64(int64_t x, int y)
+{
+    int r = (int)mod64(x, y);
+    return r == 0 ? y : r;
+}
+
+static inline bool fixed64_in_range(int64_t date)
+{
+    return date >= -FIXED64_LIMIT && date <= FIXED64_LIMIT;
+}
+
+static inline bool year64_in_range(int64_t year)
+{
+    return year >= -YEAR64_LIMIT && year <= YEAR64_LIMIT;
+}
+
+int day_of_week_from_fixed64(int64_t date)
+{
+    return (int)mod64(date, 7);
+}
+
+static inline int64_t kday_on_or_before64(int64_t date, int k)
+{
+    return date - mod64(date - k, 7);
+}
+
+/* The days before month in a year of the Gregorian or Julian calendar,
+   with leap saying whether it has February 29. */
+static inline int64_t days_before_month(int month, bool leap)
+{
+    int correction;
+    if (month <= 2) correction = 0;
+    else if (leap) correction = -1;
+    else correction = -2;
+    return quotient64(367 * (int64_t)month - 362, 12) + correction;
+}
+
+#pragma mark Gregorian
+
+bool gregorian_leap_year64(int64_t year)
+{
+    int64_t y400 = mod64(year, 400);
+    return mod64(year, 4) == 0 && y400 != 100 && y400 != 200 && y400 != 300;
+}
+
+/* December 31 of the year before. */
+static inline int64_t gregorian_year_start64(int64_t year)
+{
+    int64_t y = year - 1;
+    return 365 * y + quotient64(y, 4) - quotient64(y, 100) + quotient64(y, 400);
+}
+
+int64_t fixed_from_gregorian64(int64_t year, int month, int day)
+{
+    return gregorian_year_start64(year) +
+        days_before_month(month, gregorian_leap_year64(year)) + day;
+}
+
+int64_t gregorian_year_from_fixed64(int64_t date)
+{
+    int64_t d0 = date - 1;
+    int64_t n400 = quotient64(d0, 146097);
+    int d1 = (int)mod64(d0, 146097);
+    int n100 = d1 / 36524;
+    int d2 = d1 % 36524;
+    int n4 = d2 / 1461;
+    int d3 = d2 % 1461;
+    int n1 = d3 / 365;
+    int64_t year = 400 * n400 + 100 * n100 + 4 * n4 + n1;
+    if (n100 == 4 || n1 == 4) return year;
+    return year + 1;
+}
+
+void gregorian_from_fixed64(int64_t date, int64_t *ryear, int *rmonth, int *rday)
+{
+    int64_t year = gregorian_year_from_fixed64(date);
+    int64_t start = gregorian_year_start64(year);
+    bool leap = gregorian_leap_year64(year);
+    int prior_days = (int)(date - start - 1);
+
+    int correction;
+    if (prior_days < (leap ? 60 : 59)) correction = 0;
+    else if (leap) correction = 1;
+    else correction = 2;
+
+    int month = (12 * (prior_days + correction) + 373) / 367;
+    if (ryear) *ryear = year;
+    if (rmonth) *rmonth = month;
+    if (rday) *rday = (int)(date - start - days_before_month(month, leap));
+}
+
+#pragma mark Julian
+
+/* There is no year 0, so 1 BCE, 5 BCE and so on are the leap years
+   before it. */
+bool julian_leap_year64(int64_t year)
+{
+    return mod64(year, 4) == (year > 0 ? 0 : 3);
+}
+
+static inline int64_t julian_year_start64(int64_t year)
+{
+    int64_t y = year < 0 ? year + 1 : year;
+    return -2 + 365 * (y - 1) + quotient64(y - 1, 4);
+}
+
+int64_t fixed_from_julian64(int64_t year, int month, int day)
+{
+    return julian_year_start64(year) +
+        days_before_month(month, julian_leap_year64(year)) + day;
+}
+
+void julian_from_fixed64(int64_t date, int64_t *ryear, int *rmonth, int *rday)
+{
+    int64_t approx = quotient64(4 * date + 1468, 1461);
+    int64_t year = approx <= 0 ? approx - 1 : approx;
+    int64_t start = julian_year_start64(year);
+    bool leap = julian_leap_year64(year);
+    int prior_days = (int)(date - start - 1);
+
+    int correction;
+    if (prior_days < (leap ? 60 : 59)) correction = 0;
+    else if (leap) correction = 1;
+    else correction = 2;
+
+    int month = (12 * (prior_days + correction) + 373) / 367;
+    if (ryear) *ryear = year;
+    if (rmonth) *rmonth = month;
+    if (rday) *rday = (int)(date - start - days_before_month(month, leap));
+}
+
+#pragma mark Islamic
+
+bool islamic_leap_year64(int64_t year)
+{
+    return mod64(14 + 11 * year, 30) < 11;
+}
+
+static inline int64_t islamic_year_start64(int64_t year)
+{
+    return (year - 1) * 354 + quotient64(3 + 11 * year, 30) + EPOCH_ISLAMIC - 1;
+}
+
+static inline int64_t islamic_days_before_month(int month)
+{
+    return 29 * ((int64_t)month - 1) + quotient64(6 * (int64_t)month - 1, 11);
+}
+
+int64_t fixed_from_islamic64(int64_t year, int month, int day)
+{
+    return islamic_year_start64(year) + islamic_days_before_month(month) + day;
+}
+
+void islamic_from_fixed64(int64_t date, int64_t *ryear, int *rmonth, int *rday)
+{
+    int64_t year = quotient64(30 * (date - EPOCH_ISLAMIC) + 10646, 10631);
+    int64_t start = islamic_year_start64(year);
+    int prior_days = (int)(date - start - 1);
+    int month = (11 * prior_days + 330) / 325;
+
+    if (ryear) *ryear = year;
+    if (rmonth) *rmonth = month;
+    if (rday) *rday = (int)(date - start - islamic_days_before_month(month));
+}
+
+#pragma mark Hebrew
+
+bool hebrew_leap_year64(int64_t year)
+{
+    return mod64(1 + 7 * year, 19) < 7;
+}
+
+static int64_t hebrew_calendar_elapsed_days64(int64_t year)
+{
+    int64_t months_elapsed = quotient64(235 * year - 234, 19);
+    int64_t parts_elapsed = 12084 + 13753 * months_elapsed;
+    int64_t day = 29 * months_elapsed + quotient64(parts_elapsed, 25920);
+    return mod64(3 * (day + 1), 7) < 3 ? day + 1 : day;
+}
+
+/* The new years of year and year + 1, from the four elapsed days that
+   hebrew_year_length_correction needs for the two of them. */
+static void hebrew_year_bounds64(int64_t year, int64_t *start, int64_t *end)
+{
+    int64_t ny0 = hebrew_calendar_elapsed_days64(year - 1);
+    int64_t ny1 = hebrew_calendar_elapsed_days64(year);
+    int64_t ny2 = hebrew_calendar_elapsed_days64(year + 1);
+    int64_t ny3 = hebrew_calendar_elapsed_days64(year + 2);
+    int c1 = ny2 - ny1 == 356 ? 2 : ny1 - ny0 == 382 ? 1 : 0;
+    int c2 = ny3 - ny2 == 356 ? 2 : ny2 - ny1 == 382 ? 1 : 0;
+    *start = EPOCH_HEBREW + ny1 + c1;
+    *end = EPOCH_HEBREW + ny2 + c2;
+}
+
+int64_t hebrew_new_year64(int64_t year)
+{
+    int64_t start, end;
+    hebrew_year_bounds64(year, &start, &end);
+    return start;
+}
+
+/* last_day_of_hebrew_month, knowing the year's length. */
+static inline int hebrew_month_length(int month, int days)
+{
+    bool leap = days > 355;
+    switch (month) {
+        case 2: case 4: case 6: case 10: case 13: return 29;
+        case 12: return leap ? 30 : 29;
+        case 8: return days == 355 || days == 385 ? 30 : 29;
+        case 9: return days == 353 || days == 383 ? 29 : 30;
+        default: return 30;
+    }
+}
+
+/* The days from the new year to the first of month, counting from
+   Tishri (7) as fixed_from_hebrew does. */
+static int64_t hebrew_days_before_month(int month, int days)
+{
+    int64_t before = 0;
+    if (month < 7) {
+        int last = days > 355 ? 13 : 12;
+        for (int i = 7; i <= last; i++) before += hebrew_month_length(i, days);
+        for (int i = 1; i < month; i++) before += hebrew_month_length(i, days);
+    } else {
+        for (int i = 7; i < month; i++) before += hebrew_month_length(i, days);
+    }
+    return before;
+}
+
+int64_t fixed_from_hebrew64(int64_t year, int month, int day)
+{
+    int64_t start, end;
+    hebrew_year_bounds64(year, &start, &end);
+    return start + hebrew_days_before_month(month, (int)(end - start)) + day - 1;
+}
+
+void hebrew_from_fixed64(int64_t date, int64_t *ryear, int *rmonth, int *rday)
+{
+    /* The mean year gets within a year of it; far out, the double can
+       be a little off either way. */
+    int64_t year = (int64_t)floor((98496.0 / 35975351.0) * (double)(date - EPOCH_HEBREW));
+    int64_t start, end;
+    hebrew_year_bounds64(year, &start, &end);
+    while (date >= end) hebrew_year_bounds64(++year, &start, &end);
+    while (date < start) hebrew_year_bounds64(--year, &start, &end);
+
+    int days = (int)(end - start);
+    int months = days > 355 ? 13 : 12;
+    int day = (int)(date - start);
+    int month = 7;
+    for (;;) {
+        int length = hebrew_month_length(month, days);
+        if (day < length) break;
+        day -= length;
+        month = month == months ? 1 : month + 1;
+    }
+
+    if (ryear) *ryear = year;
+    if (rmonth) *rmonth = month;
+    if (rday) *rday = day + 1;
+}
+
+#pragma mark ISO
+
+/* The week days of ISO weeks are 1 (Monday) to 7 (Sunday); week 1 is the
+   one with the year's first Thursday. */
+int64_t fixed_from_iso64(int64_t year, int week, int day)
+{
+    int64_t december28 = fixed_from_gregorian64(year - 1, 12, 28);
+    int64_t sunday = week > 0 ? kday_on_or_before64(december28 - 1, 0)
+                              : kday_on_or_before64(december28 + 7, 0);
+    return sunday + 7 * (int64_t)week + day;
+}
+
+void iso_from_fixed64(int64_t date, int64_t *ryear, int *rweek, int *rday)
+{
+    int64_t approx = gregorian_year_from_fixed64(date - 3);
+    int64_t year = date >= fixed_from_iso64(approx + 1, 1, 1) ? approx + 1 : approx;
+
+    if (ryear) *ryear = year;
+    if (rweek) *rweek = 1 + (int)quotient64(date - fixed_from_iso64(year, 1, 1), 7);
+    if (rday) *rday = amod64(date, 7);
+}
+
+#pragma mark Mayan
+
+int64_t fixed_from_mayan_long_count64(int64_t baktun, int katun, int tun,
+                                      int uinal, int kin)
+{
+    return EPOCH_MAYAN + baktun * 144000 + (int64_t)katun * 7200 +
+        (int64_t)tun * 360 + (int64_t)uinal * 20 + kin;
+}
+
+void mayan_long_count_from_fixed64(int64_t date, int64_t *rbaktun, int *rkatun,
+                                   int *rtun, int *ruinal, int *rkin)
+{
+    int64_t long_count = date - EPOCH_MAYAN;
+    int day_of_baktun = (int)mod64(long_count, 144000);
+
+    if (rbaktun) *rbaktun = quotient64(long_count, 144000);
+    if (rkatun) *rkatun = day_of_baktun / 7200;
+    if (rtun) *rtun = day_of_baktun % 7200 / 360;
+    if (ruinal) *ruinal = day_of_baktun % 360 / 20;
+    if (rkin) *rkin = day_of_baktun % 20;
+}
+
+#pragma mark Checked
+
+/* Month and day can't overflow an int64_t when the year is in range, so
+   only the year and the date that comes of it need looking at. */
+#define CHECKED_TO_FIXED(name, first)                                       \
+bool name##_checked(int64_t first, int a, int b, int64_t *rdate)           \
+{                                                                           \
+    if (!year64_in_range(first)) return false;                              \
+    int64_t date = name(first, a, b);                                       \
+    if (!fixed64_in_range(date)) return false;                              \
+    if (rdate) *rdate = date;                                               \
+    return true;                                                            \
+}
+
+#define CHECKED_FROM_FIXED(name)                                            \
+bool name##_checked(int64_t date, int64_t *ryear, int *ra, int *rb)        \
+{                                                                           \
+    if (!fixed64_in_range(date)) return false;                              \
+    name(date, ryear, ra, rb);                                              \
+    return true;                                                            \
+}
+
+CHECKED_TO_FIXED(fixed_from_gregorian64, year)
+CHECKED_FROM_FIXED(gregorian_from_fixed64)
+CHECKED_TO_FIXED(fixed_from_julian64, year)
+CHECKED_FROM_FIXED(julian_from_fixed64)
+CHECKED_TO_FIXED(fixed_from_islamic64, year)
+CHECKED_FROM_FIXED(islamic_from_fixed64)
+CHECKED_FROM_FIXED(hebrew_from_fixed64)
+CHECKED_TO_FIXED(fixed_from_iso64, year)
+CHECKED_FROM_FIXED(iso_from_fixed64)
+
+/* The Hebrew days before a month are counted month by month, so the month
+   has to be one of the year's. */
+bool fixed_from_hebrew64_checked(int64_t year, int month, int day, int64_t *rdate)
+{
+    if (!year64_in_range(year)) return false;
+    if (month < 1 || month > (hebrew_leap_year64(year) ? 13 : 12)) return false;
+    int64_t date = fixed_from_hebrew64(year, month, day);
+    if (!fixed64_in_range(date)) return false;
+    if (rdate) *rdate = date;
+    return true;
+}
+
+bool fixed_from_mayan_long_count64_checked(int64_t baktun, int katun, int tun,
+                                           int uinal, int kin, int64_t *rdate)
+{
+    if (baktun < -FIXED64_LIMIT / 144000 || baktun > FIXED64_LIMIT / 144000)
+        return false;
+    int64_t date = fixed_from_mayan_long_count64(baktun, katun, tun, uinal, kin);
+    if (!fixed64_in_range(date)) return false;
+    if (rdate) *rdate = date;
+    return true;
+}
+
+bool mayan_long_count_from_fixed64_checked(int64_t date, int64_t *rbaktun, int *rkatun,
+                                           int *rtun, int *ruinal, int *rkin)
+{
+    if (!fixed64_in_range(date)) return false;
+    mayan_long_count_from_fixed64(date, rbaktun, rkatun, rtun, ruinal, rkin);
+    return true;
+}
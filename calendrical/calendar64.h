@@ -0,0 +1,72 @@
+#ifndef CALENDAR64_H
+#define CALENDAR64_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Fixed dates and years as int64_t, for the arithmetic calendars.
+ *
+ * The int functions in calendar.h overflow silently once the days reach
+ * INT_MAX: fixed_from_gregorian past about 5.8 million years, and
+ * islamic_from_fixed, which multiplies the date by 30, at a fifteenth of
+ * that. These do the same conversions in 64-bit integer arithmetic and
+ * agree with them wherever those don't overflow.
+ *
+ * They are exact for dates within FIXED64_LIMIT of day 0, some three
+ * trillion years either way, and for the years those dates fall in, which
+ * are within YEAR64_LIMIT of year 0; nothing is checked. The _checked
+ * forms return false instead of a result when their arguments are outside
+ * those limits, or the date worked out is, and don't touch the results
+ * then. Months, days and the smaller Mayan units may be any int, as in
+ * calendar.h, but for a Hebrew month, which must be one of its year's.
+ *
+ * The int functions stay the quick ones for dates people use. */
+
+#define FIXED64_LIMIT (INT64_C(1) << 50)
+#define YEAR64_LIMIT (FIXED64_LIMIT / 353)    /* the shortest year, Hebrew */
+
+/* Sunday is 0 */
+int day_of_week_from_fixed64(int64_t date) __attribute__((const));
+
+bool gregorian_leap_year64(int64_t year) __attribute__((const));
+int64_t fixed_from_gregorian64(int64_t year, int month, int day) __attribute__((const));
+int64_t gregorian_year_from_fixed64(int64_t date) __attribute__((const));
+void gregorian_from_fixed64(int64_t date, int64_t *ryear, int *rmonth, int *rday);
+
+bool julian_leap_year64(int64_t year) __attribute__((const));
+int64_t fixed_from_julian64(int64_t year, int month, int day) __attribute__((const));
+void julian_from_fixed64(int64_t date, int64_t *ryear, int *rmonth, int *rday);
+
+bool islamic_leap_year64(int64_t year) __attribute__((const));
+int64_t fixed_from_islamic64(int64_t year, int month, int day) __attribute__((const));
+void islamic_from_fixed64(int64_t date, int64_t *ryear, int *rmonth, int *rday);
+
+bool hebrew_leap_year64(int64_t year) __attribute__((const));
+int64_t hebrew_new_year64(int64_t year) __attribute__((const));
+int64_t fixed_from_hebrew64(int64_t year, int month, int day) __attribute__((const));
+void hebrew_from_fixed64(int64_t date, int64_t *ryear, int *rmonth, int *rday);
+
+int64_t fixed_from_iso64(int64_t year, int week, int day) __attribute__((const));
+void iso_from_fixed64(int64_t date, int64_t *ryear, int *rweek, int *rday);
+
+int64_t fixed_from_mayan_long_count64(int64_t baktun, int katun, int tun,
+                                      int uinal, int kin) __attribute__((const));
+void mayan_long_count_from_fixed64(int64_t date, int64_t *rbaktun, int *rkatun,
+                                   int *rtun, int *ruinal, int *rkin);
+
+bool fixed_from_gregorian64_checked(int64_t year, int month, int day, int64_t *rdate);
+bool gregorian_from_fixed64_checked(int64_t date, int64_t *ryear, int *rmonth, int *rday);
+bool fixed_from_julian64_checked(int64_t year, int month, int day, int64_t *rdate);
+bool julian_from_fixed64_checked(int64_t date, int64_t *ryear, int *rmonth, int *rday);
+bool fixed_from_islamic64_checked(int64_t year, int month, int day, int64_t *rdate);
+bool islamic_from_fixed64_checked(int64_t date, int64_t *ryear, int *rmonth, int *rday);
+bool fixed_from_hebrew64_checked(int64_t year, int month, int day, int64_t *rdate);
+bool hebrew_from_fixed64_checked(int64_t date, int64_t *ryear, int *rmonth, int *rday);
+bool fixed_from_iso64_checked(int64_t year, int week, int day, int64_t *rdate);
+bool iso_from_fixed64_checked(int64_t date, int64_t *ryear, int *rweek, int *rday);
+bool fixed_from_mayan_long_count64_checked(int64_t baktun, int katun, int tun,
+                                           int uinal, int kin, int64_t *rdate);
+bool mayan_long_count_from_fixed64_checked(int64_t date, int64_t *rbaktun, int *rkatun,
+                                           int *rtun, int *ruinal, int *rkin);
+
+#endif
@@ -0,0 +1,239 @@
+/*
+ *  calendar_inline.h
+ *  The cheap arithmetic functions from calendar.h.
+ *
+ *  calendar.c compiles these as ordinary library functions. Define
+ *  CALENDRICAL_INLINE before including calendar.h to get them as static
+ *  inline definitions instead, so that they inline into the caller and
+ *  loops over them can be vectorized.
+ *
+ *  Everything here is integer arithmetic (except the Julian day
+ *  conversions, which are double by nature). The results are the same
+ *  as the book's floor-based definitions.
+ */
+
+#ifndef CALENDAR_INLINE_H
+#define CALENDAR_INLINE_H
+
+#include <stdbool.h>
+#include <math.h>
+
+#ifndef CALENDRICAL_API
+#define CALENDRICAL_API static inline
+#endif
+
+/* Floor modulus and quotient, for a positive divisor. */
+static inline int calendrical_mod(int x, int y)
+{
+    int r = x % y;
+    return r < 0 ? r + y : r;
+}
+
+static inline int calendrical_quotient(int x, int y)
+{
+    return (x - calendrical_mod(x, y)) / y;
+}
+
+/* Sunday is 0 */
+CALENDRICAL_API int day_of_week_from_fixed(int date)
+{
+    return calendrical_mod(date, 7);
+}
+
+CALENDRICAL_API int kday_on_or_before(int date, int k)
+{
+    return date - calendrical_mod(date - k, 7);
+}
+
+CALENDRICAL_API int kday_nearest(int date, int k)
+{
+    return kday_on_or_before(date + 3, k);
+}
+
+CALENDRICAL_API int kday_on_or_after(int date, int k)
+{
+    return kday_on_or_before(date + 6, k);
+}
+
+CALENDRICAL_API int kday_before(int date, int k)
+{
+    return kday_on_or_before(date - 1, k);
+}
+
+CALENDRICAL_API int kday_after(int date, int k)
+{
+    return kday_on_or_before(date + 7, k);
+}
+
+CALENDRICAL_API double moment_from_jd(double jd)
+{
+    return jd - 1721424.5;      /* EPOCH_JD */
+}
+
+CALENDRICAL_API double jd_from_moment(double t)
+{
+    return t + 1721424.5;
+}
+
+CALENDRICAL_API int fixed_from_jd(double jd)
+{
+    return (int)floor(moment_from_jd(jd));
+}
+
+CALENDRICAL_API double jd_from_fixed(int date)
+{
+    return jd_from_moment((double)date);
+}
+
+CALENDRICAL_API int fixed_from_mjd(int mjd)
+{
+    return mjd + 678576;        /* EPOCH_MJD */
+}
+
+CALENDRICAL_API int mjd_from_fixed(int date)
+{
+    return date - 678576;
+}
+
+CALENDRICAL_API bool gregorian_leap_year(int year)
+{
+    int y400 = calendrical_mod(year, 400);
+    return calendrical_mod(year, 4) == 0 &&
+        y400 != 100 && y400 != 200 && y400 != 300;
+}
+
+/* 31 and 30 alternate, with the phase flipping at August. */
+CALENDRICAL_API int last_day_of_gregorian_month(int month, int year)
+{
+    if (month < 1 || month > 12) return 0;
+    if (month == 2) return gregorian_leap_year(year) ? 29 : 28;
+    return 30 + ((month + month / 8) & 1);
+}
+
+CALENDRICAL_API int fixed_from_gregorian(int year, int month, int day)
+{
+    int y = year - 1;
+    int correction;
+    if (month <= 2) correction = 0;
+    else if (gregorian_leap_year(year)) correction = -1;
+    else correction = -2;
+
+    return 365 * y +
+        calendrical_quotient(y, 4) -
+        calendrical_quotient(y, 100) +
+        calendrical_quotient(y, 400) +
+        calendrical_quotient(367 * month - 362, 12) +
+        correction + day;
+}
+
+CALENDRICAL_API int gregorian_year_from_fixed(int date)
+{
+    int d0 = date - 1;
+    int n400 = calendrical_quotient(d0, 146097);
+    int d1 = calendrical_mod(d0, 146097);
+    int n100 = d1 / 36524;
+    int d2 = d1 % 36524;
+    int n4 = d2 / 1461;
+    int d3 = d2 % 1461;
+    int n1 = d3 / 365;
+    int year = 400 * n400 + 100 * n100 + 4 * n4 + n1;
+    if (n100 == 4 || n1 == 4) return year;
+    return year + 1;
+}
+
+/* Sunday is 0. */
+CALENDRICAL_API int nth_kday(int n, int k, int year, int month, int day)
+{
+    if (n > 0)
+        return 7 * n + kday_before(fixed_from_gregorian(year,month,day),k);
+
+    return 7 * n + kday_after(fixed_from_gregorian(year,month,day),k);
+}
+
+/* Negative values of n count back from the end of the month. */
+CALENDRICAL_API int nth_kday_in_month(int n, int k, int year, int month)
+{
+    if (n > 0)
+        return kday_on_or_before(fixed_from_gregorian(year,month,7), k)
+            + (7 * (n - 1));
+    return
+        kday_on_or_before(fixed_from_gregorian(year,month,
+            last_day_of_gregorian_month(month, year)),k) + (7 * (1 + n));
+}
+
+/* There is no year 0, so 1 BCE, 5 BCE and so on are the leap years
+   before it. */
+CALENDRICAL_API bool julian_leap_year(int year)
+{
+    return calendrical_mod(year, 4) == (year > 0 ? 0 : 3);
+}
+
+CALENDRICAL_API int last_day_of_julian_month(int month, int year)
+{
+    if (month < 1 || month > 12) return 0;
+    if (month == 2) return julian_leap_year(year) ? 29 : 28;
+    return 30 + ((month + month / 8) & 1);
+}
+
+CALENDRICAL_API int fixed_from_julian(int year, int month, int day)
+{
+    int y = year < 0 ? year + 1 : year;
+    int correction;
+    if (month <= 2) correction = 0;
+    else if (julian_leap_year(year)) correction = -1;
+    else correction = -2;
+
+    return -2 + (365 * (y - 1)) +
+        calendrical_quotient(y - 1, 4) +
+        calendrical_quotient(367 * month - 362, 12) +
+        correction + day;
+}
+
+CALENDRICAL_API bool islamic_leap_year(int year)
+{
+    return calendrical_mod(14 + (11 * year), 30) < 11;
+}
+
+CALENDRICAL_API int last_day_of_islamic_month(int month, int year)
+{
+    return ((month % 2) ||
+        ((month == 12) && islamic_leap_year(year))) ?
+        30 : 29;
+}
+
+CALENDRICAL_API int fixed_from_islamic(int year, int month, int day)
+{
+    return day + (29 * (month - 1)) + calendrical_quotient(6 * month - 1, 11) +
+            (year - 1) * 354 +
+            calendrical_quotient(3 + (11 * year), 30) +
+            227015 - 1;         /* EPOCH_ISLAMIC */
+}
+
+CALENDRICAL_API bool hebrew_leap_year(int year)
+{
+    return calendrical_mod(1 + (7 * year), 19) < 7;
+}
+
+CALENDRICAL_API int fixed_from_mayan_long_count(int baktun, int katun, int tun,
+                                                int uinal, int kin)
+{
+    return -1137142 + baktun * 144000 + katun * 7200 +      /* EPOCH_MAYAN */
+            tun * 360 + uinal * 20 + kin;
+}
+
+CALENDRICAL_API int mayan_haab_ordinal(int month, int day)
+{
+    return ((month - 1) * 20 + day);
+}
+
+CALENDRICAL_API int mayan_tzolkin_ordinal(int number, int name)
+{
+    return calendrical_mod(number - 1 + 39 * (number - name), 260);
+}
+
+CALENDRICAL_API int fixed_from_iso(int year, int week, int day)
+{
+    return nth_kday(week, 0, year - 1, 12, 28) + day;
+}
+
+#endif
@@ -0,0 +1,372 @@
+/* Answer calendar queries over a Unix-domain socket, keeping Chinese
+   years, Hebrew years and new moons warm in memory between them.
+   See calclient.h for the protocol.
+
+   usage: calendard [socket]
+
+   One thread serves every connection with poll(), so the caches need
+   no locking. Requests on a connection are answered in order, as many
+   at a time as have arrived. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "calendar.h"
+#include "lunation.h"
+#include "calclient.h"
+
+#pragma mark Caches
+
+/* Years further out than this are refused, as their dates would come
+   near the limits of an int. */
+#define YEAR_LIMIT 5000000
+
+/* Chinese years by the Gregorian year they start in. */
+#define CHINESE_FIRST 1000
+#define CHINESE_LAST 3000
+static struct ChineseYearInfo *chinese_years[CHINESE_LAST - CHINESE_FIRST + 1];
+
+static const struct ChineseYearInfo *chinese_year(int gyear)
+{
+    if (gyear < CHINESE_FIRST || gyear > CHINESE_LAST) return NULL;
+    struct ChineseYearInfo **slot = &chinese_years[gyear - CHINESE_FIRST];
+    if (*slot == NULL) {
+        struct ChineseYearInfo *info = malloc(sizeof(*info));
+        if (info == NULL) return NULL;
+        chinese_year_info(fixed_from_gregorian(gyear, 7, 1), info);
+        *slot = info;
+    }
+    return *slot;
+}
+
+static const struct ChineseYearInfo *chinese_year_of(int date)
+{
+    int gyear = gregorian_year_from_fixed(date);
+    const struct ChineseYearInfo *info = chinese_year(gyear);
+    if (info && date < info->new_year) info = chinese_year(gyear - 1);
+    return info;
+}
+
+/* Hebrew years, with the first day of each month. */
+#define HEBREW_FIRST 3000
+#define HEBREW_LAST 7000
+
+struct HebrewYear {
+    int new_year;
+    int next_new_year;
+    int last_month;
+    int month_start[14];    /* by month number, 1 (Nisan) to last_month */
+};
+static struct HebrewYear *hebrew_years[HEBREW_LAST - HEBREW_FIRST + 1];
+static int hebrew_epoch;
+
+static const struct HebrewYear *hebrew_year(int year)
+{
+    if (year < HEBREW_FIRST || year > HEBREW_LAST) return NULL;
+    struct HebrewYear **slot = &hebrew_years[year - HEBREW_FIRST];
+    if (*slot == NULL) {
+        struct HebrewYear *h = malloc(sizeof(*h));
+        if (h == NULL) return NULL;
+        h->new_year = fixed_from_hebrew(year, 7, 1);
+        h->next_new_year = fixed_from_hebrew(year + 1, 7, 1);
+        h->last_month = last_month_of_hebrew_year(year);
+        for (int m = 1; m <= h->last_month; m++)
+            h->month_start[m] = fixed_from_hebrew(year, m, 1);
+        *slot = h;
+    }
+    return *slot;
+}
+
+static void hebrew_from_fixed_cached(int date, int *ryear, int *rmonth, int *rday)
+{
+    /* The same estimate hebrew_from_fixed starts from. */
+    int year = 1 + (int)floor((98496.0 / 35975351.0) * (date - hebrew_epoch));
+    const struct HebrewYear *h = hebrew_year(year);
+    if (h && date >= h->next_new_year) h = hebrew_year(++year);
+    while (h && date < h->new_year) h = hebrew_year(--year);
+    if (h == NULL) {
+        hebrew_from_fixed(date, ryear, rmonth, rday);
+        return;
+    }
+    int month = 7;
+    for (int m = 1; m <= h->last_month; m++)
+        if (h->month_start[m] <= date && h->month_start[m] > h->month_start[month])
+            month = m;
+    *ryear = year;
+    *rmonth = month;
+    *rday = date - h->month_start[month] + 1;
+}
+
+static struct LunationTable *new_moons;
+
+#pragma mark Requests
+
+#define IN_SIZE (256 * sizeof(struct CaldRequest))
+#define OUT_LIMIT (1 << 20)     /* stop reading while this much is unsent */
+
+struct Connection {
+    int fd;
+    size_t in_len;
+    unsigned char in[IN_SIZE];
+    unsigned char *out;
+    size_t out_len;
+    size_t out_sent;
+    size_t out_cap;
+};
+
+static bool reply(struct Connection *c, uint32_t id, int status, int remaining,
+                  const int32_t values[5])
+{
+    if (c->out_len + sizeof(struct CaldResponse) > c->out_cap) {
+        size_t cap = c->out_cap ? 2 * c->out_cap : 4096;
+        unsigned char *out = realloc(c->out, cap);
+        if (out == NULL) return false;
+        c->out = out;
+        c->out_cap = cap;
+    }
+    struct CaldResponse r = { id, status, remaining, { 0 } };
+    if (values) memcpy(r.values, values, sizeof(r.values));
+    memcpy(c->out + c->out_len, &r, sizeof(r));
+    c->out_len += sizeof(r);
+    return true;
+}
+
+static bool chinese_months(struct Connection *c, const struct CaldRequest *q)
+{
+    struct ChineseYearInfo computed;
+    const struct ChineseYearInfo *info = chinese_year_of(q->args[0]);
+    if (info == NULL) {
+        chinese_year_info(q->args[0], &computed);
+        info = &computed;
+    }
+    for (int i = 0; i < info->months; i++) {
+        int32_t v[5] = { info->month_start[i],
+            (info->leap_month < 0 || i < info->leap_month) ? i + 1 : i,
+            i == info->leap_month };
+        if (!reply(c, q->id, CALD_OK, info->months - 1 - i, v)) return false;
+    }
+    return true;
+}
+
+static bool new_moons_between(struct Connection *c, const struct CaldRequest *q)
+{
+    int from = q->args[0], to = q->args[1];
+    struct Lunation l;
+    lunation_from_moment(new_moons, from, &l);
+    int n = l.start < from ? l.number + 1 : l.number;
+    int count = 0;
+    while (count <= CALD_MAX_RANGE && lunation_start(new_moons, n + count) < to) count++;
+    if (to < from || count > CALD_MAX_RANGE)
+        return reply(c, q->id, CALD_BAD_RANGE, 0, NULL);
+    if (count == 0) return reply(c, q->id, CALD_EMPTY, 0, NULL);
+
+    for (int i = 0; i < count; i++) {
+        double t = lunation_start(new_moons, n + i);
+        int date = (int)floor(t);
+        int32_t v[5] = { date, (int32_t)((t - date) * 86400000), n + i };
+        if (!reply(c, q->id, CALD_OK, count - 1 - i, v)) return false;
+    }
+    return true;
+}
+
+static bool answer(struct Connection *c, const struct CaldRequest *q)
+{
+    const int32_t *a = q->args;
+    int32_t v[5] = { 0 };
+    switch (q->op) {
+    case CALD_CHINESE_FROM_FIXED: {
+        struct ChineseDate cd;
+        const struct ChineseYearInfo *info = chinese_year_of(a[0]);
+        if (info) chinese_from_fixed_with(info, a[0], &cd);
+        else chinese_from_fixed(a[0], &cd);
+        v[0] = cd.cycle; v[1] = cd.year; v[2] = cd.month; v[3] = cd.leap; v[4] = cd.day;
+        break;
+    }
+    case CALD_FIXED_FROM_CHINESE: {
+        struct ChineseDate cd = { a[0], a[1], a[2], a[3] != 0, a[4] };
+        /* Chinese year 1 of cycle 1 began in 2637 BCE, which is Gregorian -2636. */
+        long long year = ((long long)a[0] - 1) * 60 + a[1] - 2637;
+        if (year < -YEAR_LIMIT || year > YEAR_LIMIT || a[2] < 1 || a[2] > 12)
+            return reply(c, q->id, CALD_BAD_ARGS, 0, NULL);
+        const struct ChineseYearInfo *info = chinese_year((int)year);
+        v[0] = info ? fixed_from_chinese_with(info, cd) : fixed_from_chinese(cd);
+        break;
+    }
+    case CALD_HEBREW_FROM_FIXED:
+        hebrew_from_fixed_cached(a[0], &v[0], &v[1], &v[2]);
+        break;
+    case CALD_FIXED_FROM_HEBREW: {
+        /* fixed_from_hebrew counts the months one by one. */
+        if (a[0] < -YEAR_LIMIT || a[0] > YEAR_LIMIT ||
+            a[1] < 1 || a[1] > last_month_of_hebrew_year(a[0]))
+            return reply(c, q->id, CALD_BAD_ARGS, 0, NULL);
+        const struct HebrewYear *h = hebrew_year(a[0]);
+        v[0] = h ? h->month_start[a[1]] + a[2] - 1 : fixed_from_hebrew(a[0], a[1], a[2]);
+        break;
+    }
+    case CALD_MAYAN_LONG_COUNT:
+        mayan_long_count_from_fixed(a[0], &v[0], &v[1], &v[2], &v[3], &v[4]);
+        break;
+    case CALD_MAYAN_CALENDAR_ROUND:
+        mayan_haab_from_fixed(a[0], &v[0], &v[1]);
+        mayan_tzolkin_from_fixed(a[0], &v[2], &v[3]);
+        break;
+    case CALD_CHINESE_NEW_YEAR: {
+        const struct ChineseYearInfo *info = chinese_year(a[0]);
+        v[0] = info ? info->new_year : chinese_new_year(a[0]);
+        break;
+    }
+    case CALD_CHINESE_MONTHS:
+        return chinese_months(c, q);
+    case CALD_NEW_MOONS:
+        return new_moons_between(c, q);
+    default:
+        return reply(c, q->id, CALD_BAD_OP, 0, NULL);
+    }
+    return reply(c, q->id, CALD_OK, 0, v);
+}
+
+#pragma mark Connections
+
+#define MAX_CONNECTIONS 256
+
+static struct pollfd fds[MAX_CONNECTIONS + 1];     /* fds[0] listens */
+static struct Connection *connections[MAX_CONNECTIONS + 1];
+static int nfds = 1;
+static const char *socket_path;
+
+static void drop(int i)
+{
+    close(connections[i]->fd);
+    free(connections[i]->out);
+    free(connections[i]);
+    nfds--;
+    fds[i] = fds[nfds];
+    connections[i] = connections[nfds];
+}
+
+/* Read what's there and answer every whole request in it.
+   Returns false when the connection should be dropped. */
+static bool serve_input(struct Connection *c)
+{
+    ssize_t k = read(c->fd, c->in + c->in_len, IN_SIZE - c->in_len);
+    if (k == 0) return false;
+    if (k < 0) return errno == EAGAIN || errno == EINTR;
+    c->in_len += k;
+
+    size_t used = 0;
+    while (c->in_len - used >= sizeof(struct CaldRequest)) {
+        struct CaldRequest q;
+        memcpy(&q, c->in + used, sizeof(q));
+        if (!answer(c, &q)) return false;
+        used += sizeof(q);
+    }
+    memmove(c->in, c->in + used, c->in_len - used);
+    c->in_len -= used;
+    return true;
+}
+
+static bool serve_output(struct Connection *c)
+{
+    while (c->out_sent < c->out_len) {
+        ssize_t k = write(c->fd, c->out + c->out_sent, c->out_len - c->out_sent);
+        if (k < 0) return errno == EAGAIN || errno == EINTR;
+        c->out_sent += k;
+    }
+    c->out_len = c->out_sent = 0;
+    return true;
+}
+
+static void accept_connection(int listener)
+{
+    int fd = accept(listener, NULL, NULL);
+    if (fd < 0) return;
+    struct Connection *c = calloc(1, sizeof(*c));
+    if (nfds > MAX_CONNECTIONS || c == NULL) {
+        free(c);
+        close(fd);
+        return;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    c->fd = fd;
+    connections[nfds] = c;
+    fds[nfds] = (struct pollfd){ .fd = fd, .events = POLLIN };
+    nfds++;
+}
+
+static void quit(int sig)
+{
+    unlink(socket_path);
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+int main(int argc, char *argv[])
+{
+    socket_path = cald_socket_path(argc > 1 ? argv[1] : NULL);
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "calendard: socket path too long\n");
+        return 1;
+    }
+    strcpy(addr.sun_path, socket_path);
+
+    /* A socket left by a daemon that died can go, but not one that's
+       still answering. */
+    int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe >= 0 && connect(probe, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+        fprintf(stderr, "calendard: already running at %s\n", socket_path);
+        return 1;
+    }
+    if (probe >= 0) close(probe);
+
+    /* Warm up: new moons for 1600-2400, Chinese years for 1900-2100. */
+    hebrew_epoch = fixed_from_hebrew(1, 7, 1);
+    new_moons = lunation_table_create(fixed_from_gregorian(1600, 1, 1),
+                                      fixed_from_gregorian(2400, 1, 1));
+    for (int y = 1900; y <= 2100; y++) chinese_year(y);
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socket_path);
+    if (listener < 0 || bind(listener, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(listener, 64) < 0) {
+        perror("calendard");
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, quit);
+    signal(SIGTERM, quit);
+    fds[0] = (struct pollfd){ .fd = listener, .events = POLLIN };
+
+    for (;;) {
+        if (poll(fds, nfds, -1) < 0) {
+            if (errno == EINTR) continue;
+            perror("calendard");
+            return 1;
+        }
+        if (fds[0].revents & POLLIN) accept_connection(listener);
+        for (int i = nfds - 1; i >= 1; i--) {
+            struct Connection *c = connections[i];
+            bool ok = true;
+            if (fds[i].revents & (POLLERR | POLLHUP | POLLNVAL) && !(fds[i].revents & POLLIN))
+                ok = false;
+            if (ok && fds[i].revents & POLLIN) ok = serve_input(c);
+            if (ok) ok = serve_output(c);
+            if (!ok) {
+                drop(i);
+                continue;
+            }
+            /* Don't take more requests while the answers aren't being read. */
+            fds[i].events = (c->out_len - c->out_sent < OUT_LIMIT ? POLLIN : 0) |
+                            (c->out_len > c->out_sent ? POLLOUT : 0);
+        }
+    }
+}
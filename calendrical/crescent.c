@@ -0,0 +1,121 @@
+/*
+ *  crescent.c
+ *  Observational Islamic month starts, computed once per locale and kept.
+ */
+
+#include <stdlib.h>
+#include <pthread.h>
+#include "crescent.h"
+
+struct CrescentCache *crescent_cache_create(struct Locale locale)
+{
+    struct CrescentCache *cache = malloc(sizeof(*cache));
+    if (cache == NULL) return NULL;
+    cache->locale = locale;
+    cache->starts = (struct DateTable){ 0, 0, NULL };
+    return cache;
+}
+
+void crescent_cache_destroy(struct CrescentCache *cache)
+{
+    if (cache == NULL) return;
+    date_table_free(&cache->starts);
+    free(cache);
+}
+
+static int month_start(const struct CrescentCache *cache, int elapsed_months)
+{
+    int start = date_table_get(&cache->starts, elapsed_months);
+    if (start == DATE_TABLE_UNKNOWN)
+        start = observational_islamic_month_start(elapsed_months, cache->locale);
+    return start;
+}
+
+bool crescent_cache_precompute(struct CrescentCache *cache, int from_year, int to_year)
+{
+    /* A month either side, for the arithmetic estimate being a month off
+       and for the start of the following year. */
+    int lo = (from_year - 1) * 12 - 1;
+    int hi = to_year * 12 + 1;
+    if (hi < lo) return true;
+    if (!date_table_reserve(&cache->starts, lo, hi)) return false;
+    int *starts = cache->starts.dates - cache->starts.first;
+    for (int n = lo; n <= hi; n++)
+        if (starts[n] == DATE_TABLE_UNKNOWN)
+            starts[n] = observational_islamic_month_start(n, cache->locale);
+    return true;
+}
+
+struct precompute_job {
+    struct CrescentCache *cache;
+    int from_year;
+    int to_year;
+    bool ok;
+};
+
+static void *precompute_thread(void *arg)
+{
+    struct precompute_job *job = arg;
+    job->ok = crescent_cache_precompute(job->cache, job->from_year, job->to_year);
+    return NULL;
+}
+
+bool crescent_cache_precompute_many(struct CrescentCache *caches[], int count,
+                                    int from_year, int to_year)
+{
+    struct precompute_job *jobs = malloc(count * sizeof(*jobs));
+    pthread_t *threads = malloc(count * sizeof(*threads));
+    bool *started = malloc(count * sizeof(*started));
+    bool ok = true;
+
+    if (jobs == NULL || threads == NULL || started == NULL) {
+        /* No room for threads; do them one at a time. */
+        for (int i = 0; i < count; i++)
+            ok = crescent_cache_precompute(caches[i], from_year, to_year) && ok;
+    } else {
+        for (int i = 0; i < count; i++) {
+            jobs[i] = (struct precompute_job){ caches[i], from_year, to_year, false };
+            started[i] = pthread_create(&threads[i], NULL,
+                                        precompute_thread, &jobs[i]) == 0;
+            if (!started[i]) precompute_thread(&jobs[i]);
+        }
+        for (int i = 0; i < count; i++) {
+            if (started[i]) pthread_join(threads[i], NULL);
+            ok = jobs[i].ok && ok;
+        }
+    }
+    free(jobs);
+    free(threads);
+    free(started);
+    return ok;
+}
+
+int crescent_cache_month_start(const struct CrescentCache *cache, int year, int month)
+{
+    return month_start(cache, (year - 1) * 12 + month - 1);
+}
+
+void crescent_cache_islamic_from_fixed(const struct CrescentCache *cache, int date,
+                                       int *ryear, int *rmonth, int *rday)
+{
+    /* The arithmetic calendar is never more than a month or so off. */
+    int year, month, day;
+    islamic_from_fixed(date, &year, &month, &day);
+    int n = (year - 1) * 12 + month - 1;
+    while (month_start(cache, n) > date) n--;
+    while (month_start(cache, n + 1) <= date) n++;
+
+    year = n >= 0 ? n / 12 + 1 : (n - 11) / 12 + 1;
+    month = n - (year - 1) * 12 + 1;
+    day = date - month_start(cache, n) + 1;
+
+    if (ryear) *ryear = year;
+    if (rmonth) *rmonth = month;
+    if (rday) *rday = day;
+}
+
+int crescent_cache_fixed_from_islamic(const struct CrescentCache *cache,
+                                      int year, int month, int day)
+{
+    return crescent_cache_month_start(cache, year, month) + day - 1;
+}
@@ -0,0 +1,43 @@
+#ifndef CRESCENT_H
+#define CRESCENT_H
+
+#include <stdbool.h>
+#include "calendar.h"
+#include "datetable.h"
+
+/* Observational Islamic calendar with the month starts for one locale
+ * computed once and kept. Finding a month start takes a new moon, a few
+ * sunsets and the crescent visibility test; after that every date in the
+ * month is a lookup.
+ *
+ * Only crescent_cache_precompute fills a cache. Months outside what has
+ * been precomputed are worked out on each call and not kept, so the
+ * conversions never change the cache: any number of threads can convert
+ * with one, as long as none is precomputing into it at the time. */
+
+struct CrescentCache {
+    struct Locale locale;
+    struct DateTable starts;    /* first day of each month, by elapsed months */
+};
+
+/* Returns NULL if memory can't be allocated. */
+struct CrescentCache *crescent_cache_create(struct Locale locale);
+void crescent_cache_destroy(struct CrescentCache *cache);
+
+/* Compute the month starts for Islamic years from_year through to_year,
+ * and a month either side. Returns false if memory can't be allocated. */
+bool crescent_cache_precompute(struct CrescentCache *cache, int from_year, int to_year);
+
+/* Same, for several caches at once, one thread per cache. */
+bool crescent_cache_precompute_many(struct CrescentCache *caches[], int count,
+                                    int from_year, int to_year);
+
+/* First day of the given Islamic month. */
+int crescent_cache_month_start(const struct CrescentCache *cache, int year, int month);
+
+void crescent_cache_islamic_from_fixed(const struct CrescentCache *cache, int date,
+                                       int *ryear, int *rmonth, int *rday);
+int crescent_cache_fixed_from_islamic(const struct CrescentCache *cache,
+                                      int year, int month, int day);
+
+#endif
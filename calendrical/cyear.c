@@ -1,8 +1,12 @@
-/* Output the current Chinese year name. */
+/* Output the current Chinese year name.
+   With -d, ask calendard rather than working it out. */
 
 #include <stdio.h>
+#include <string.h>
 #include <time.h>
 #include "calendar.h"
+#include "format.h"
+#include "calclient.h"
 
 int main(int argc, char *argv[])
 {
@@ -12,12 +16,15 @@ int main(int argc, char *argv[])
 
     struct ChineseDate cdate;
     int rd = fixed_from_struct_tm(today);
-    chinese_from_fixed(rd,&cdate);
+    struct CaldClient *client = NULL;
+    if (argc > 1 && strcmp(argv[1], "-d") == 0) client = cald_connect(NULL);
+    if (!(client && cald_chinese_from_fixed(client, rd, &cdate)))
+        chinese_from_fixed(rd,&cdate);
+    cald_close(client);
 
-    int stem,branch;
-    chinese_sexagesimal_name(cdate.year, &stem, &branch);
-    printf("%s%s Year of the %s\n", Stems[stem].chinese,
-                                    Branches[branch].chinese,
-                                    Branches[branch].zodiac);
+    char line[FORMAT_MAX + 1];
+    size_t n = format_chinese_year(line, cdate.year);
+    line[n++] = '\n';
+    fwrite(line, 1, n, stdout);
     return 0;
 }
@@ -0,0 +1,390 @@
+/*
+ *  datemath.c
+ *  Month and year arithmetic on calendar dates.
+ *
+ *  Each calendar's months are numbered consecutively from some epoch, so
+ *  adding months is adding to that number and splitting it back into a
+ *  year and a month. For the Hebrew calendar the number comes from the
+ *  19-year cycle of leap years; for the Chinese, from the mean lunation.
+ */
+
+#ifndef CALENDRICAL_INLINE
+#define CALENDRICAL_INLINE
+#endif
+#include <math.h>
+#include "datemath.h"
+
+#define MEAN_TROPICAL_YEAR 365.242189
+#define MEAN_SYNODIC_MONTH 29.530588853
+
+static int min(int a, int b)
+{
+    return a < b ? a : b;
+}
+
+/* How many whole months from (month1, day1) to (month2, day2), given
+   their month numbers and the length of the second month. Landing in
+   the second month, a day past its end is clamped, so only the days
+   need comparing to see whether the last month is whole. */
+static int whole_months(int month1, int day1, int month2, int day2, int length2)
+{
+    int k = month2 - month1;
+    day1 = min(day1, length2);
+    if (k > 0 && day1 > day2) k--;
+    else if (k < 0 && day1 < day2) k++;
+    return k;
+}
+
+#pragma mark Gregorian
+
+void gregorian_add_months(int year, int month, int day, int n,
+                          int *ryear, int *rmonth, int *rday)
+{
+    int m = 12 * year + month - 1 + n;
+    year = calendrical_quotient(m, 12);
+    month = calendrical_mod(m, 12) + 1;
+    if (ryear) *ryear = year;
+    if (rmonth) *rmonth = month;
+    if (rday) *rday = min(day, last_day_of_gregorian_month(month, year));
+}
+
+void gregorian_add_years(int year, int month, int day, int n,
+                         int *ryear, int *rmonth, int *rday)
+{
+    gregorian_add_months(year, month, day, 12 * n, ryear, rmonth, rday);
+}
+
+int gregorian_months_between(int year1, int month1, int day1,
+                             int year2, int month2, int day2)
+{
+    return whole_months(12 * year1 + month1, day1, 12 * year2 + month2, day2,
+                        last_day_of_gregorian_month(month2, year2));
+}
+
+void gregorian_add_months_n(const int *restrict dates, int *restrict results,
+                            size_t count, int n)
+{
+    for (size_t i = 0; i < count; i++) {
+        int year, month, day;
+        gregorian_from_fixed(dates[i], &year, &month, &day);
+        gregorian_add_months(year, month, day, n, &year, &month, &day);
+        results[i] = fixed_from_gregorian(year, month, day);
+    }
+}
+
+void gregorian_add_years_n(const int *restrict dates, int *restrict results,
+                           size_t count, int n)
+{
+    gregorian_add_months_n(dates, results, count, 12 * n);
+}
+
+#pragma mark Julian
+
+/* Julian years skip 0; these count them without the gap. */
+static int julian_ordinal_year(int year)
+{
+    return year < 0 ? year + 1 : year;
+}
+
+static int julian_year_from_ordinal(int y)
+{
+    return y <= 0 ? y - 1 : y;
+}
+
+void julian_add_months(int year, int month, int day, int n,
+                       int *ryear, int *rmonth, int *rday)
+{
+    int m = 12 * julian_ordinal_year(year) + month - 1 + n;
+    year = julian_year_from_ordinal(calendrical_quotient(m, 12));
+    month = calendrical_mod(m, 12) + 1;
+    if (ryear) *ryear = year;
+    if (rmonth) *rmonth = month;
+    if (rday) *rday = min(day, last_day_of_julian_month(month, year));
+}
+
+void julian_add_years(int year, int month, int day, int n,
+                      int *ryear, int *rmonth, int *rday)
+{
+    julian_add_months(year, month, day, 12 * n, ryear, rmonth, rday);
+}
+
+int julian_months_between(int year1, int month1, int day1,
+                          int year2, int month2, int day2)
+{
+    return whole_months(12 * julian_ordinal_year(year1) + month1, day1,
+                        12 * julian_ordinal_year(year2) + month2, day2,
+                        last_day_of_julian_month(month2, year2));
+}
+
+void julian_add_months_n(const int *restrict dates, int *restrict results,
+                         size_t count, int n)
+{
+    for (size_t i = 0; i < count; i++) {
+        int year, month, day;
+        julian_from_fixed(dates[i], &year, &month, &day);
+        julian_add_months(year, month, day, n, &year, &month, &day);
+        results[i] = fixed_from_julian(year, month, day);
+    }
+}
+
+void julian_add_years_n(const int *restrict dates, int *restrict results,
+                        size_t count, int n)
+{
+    julian_add_months_n(dates, results, count, 12 * n);
+}
+
+#pragma mark Islamic
+
+void islamic_add_months(int year, int month, int day, int n,
+                        int *ryear, int *rmonth, int *rday)
+{
+    int m = 12 * year + month - 1 + n;
+    year = calendrical_quotient(m, 12);
+    month = calendrical_mod(m, 12) + 1;
+    if (ryear) *ryear = year;
+    if (rmonth) *rmonth = month;
+    if (rday) *rday = min(day, last_day_of_islamic_month(month, year));
+}
+
+void islamic_add_years(int year, int month, int day, int n,
+                       int *ryear, int *rmonth, int *rday)
+{
+    islamic_add_months(year, month, day, 12 * n, ryear, rmonth, rday);
+}
+
+int islamic_months_between(int year1, int month1, int day1,
+                           int year2, int month2, int day2)
+{
+    return whole_months(12 * year1 + month1, day1, 12 * year2 + month2, day2,
+                        last_day_of_islamic_month(month2, year2));
+}
+
+void islamic_add_months_n(const int *restrict dates, int *restrict results,
+                          size_t count, int n)
+{
+    for (size_t i = 0; i < count; i++) {
+        int year, month, day;
+        islamic_from_fixed(dates[i], &year, &month, &day);
+        islamic_add_months(year, month, day, n, &year, &month, &day);
+        results[i] = fixed_from_islamic(year, month, day);
+    }
+}
+
+void islamic_add_years_n(const int *restrict dates, int *restrict results,
+                         size_t count, int n)
+{
+    islamic_add_months_n(dates, results, count, 12 * n);
+}
+
+#pragma mark Hebrew
+
+/* Months before Tishri of year, as in hebrew_calendar_elapsed_days. */
+static int hebrew_months_elapsed(int year)
+{
+    return calendrical_quotient(235 * year - 234, 19);
+}
+
+/* Months are counted within the year from Tishri (7), which is 0. */
+static int hebrew_month_index(int year, int month)
+{
+    return month >= 7 ? month - 7 : month + last_month_of_hebrew_year(year) - 7;
+}
+
+static int hebrew_month_from_index(int year, int i)
+{
+    int last = last_month_of_hebrew_year(year);
+    return i < last - 6 ? i + 7 : i - last + 7;
+}
+
+static void hebrew_from_month_number(int m, int *ryear, int *rindex)
+{
+    int year = calendrical_quotient(19 * m + 234, 235) + 1;
+    while (hebrew_months_elapsed(year) > m) year--;
+    while (hebrew_months_elapsed(year + 1) <= m) year++;
+    *ryear = year;
+    *rindex = m - hebrew_months_elapsed(year);
+}
+
+static int hebrew_month_number(int year, int month)
+{
+    return hebrew_months_elapsed(year) + hebrew_month_index(year, month);
+}
+
+void hebrew_add_months(int year, int month, int day, int n,
+                       int *ryear, int *rmonth, int *rday)
+{
+    int i;
+    hebrew_from_month_number(hebrew_month_number(year, month) + n, &year, &i);
+    month = hebrew_month_from_index(year, i);
+    if (ryear) *ryear = year;
+    if (rmonth) *rmonth = month;
+    if (rday) *rday = min(day, last_day_of_hebrew_month(month, year));
+}
+
+/* The month in year of the same name as month in from_year. */
+static int hebrew_same_month(int month, int from_year, int year)
+{
+    return month == last_month_of_hebrew_year(from_year) ?
+        last_month_of_hebrew_year(year) : month;
+}
+
+void hebrew_add_years(int year, int month, int day, int n,
+                      int *ryear, int *rmonth, int *rday)
+{
+    month = hebrew_same_month(month, year, year + n);
+    year += n;
+    if (ryear) *ryear = year;
+    if (rmonth) *rmonth = month;
+    if (rday) *rday = min(day, last_day_of_hebrew_month(month, year));
+}
+
+int hebrew_months_between(int year1, int month1, int day1,
+                          int year2, int month2, int day2)
+{
+    return whole_months(hebrew_month_number(year1, month1), day1,
+                        hebrew_month_number(year2, month2), day2,
+                        last_day_of_hebrew_month(month2, year2));
+}
+
+/* Make h the year of date, stepping from the year it holds if that's
+   near, and return the index of date's month. A zeroed h holds none. */
+static int hebrew_locate(struct HebrewYearInfo *h, int date)
+{
+    if (h->months == 0 || date < h->month_start[0] - 385 ||
+        date >= h->month_start[h->months] + 385) {
+        int year;
+        hebrew_from_fixed(date, &year, NULL, NULL);
+        hebrew_year_info(year, h);
+    }
+    while (date < h->month_start[0]) hebrew_year_info(h->year - 1, h);
+    while (date >= h->month_start[h->months]) hebrew_year_info(h->year + 1, h);
+
+    int i = 0;
+    while (date >= h->month_start[i + 1]) i++;
+    return i;
+}
+
+static int hebrew_day_in(struct HebrewYearInfo *h, int year, int i, int day)
+{
+    if (h->months == 0 || h->year != year) hebrew_year_info(year, h);
+    int length = h->month_start[i + 1] - h->month_start[i];
+    return h->month_start[i] + min(day, length) - 1;
+}
+
+void hebrew_add_months_n(const int *restrict dates, int *restrict results,
+                         size_t count, int n)
+{
+    struct HebrewYearInfo from = { 0 }, to = { 0 };
+    for (size_t k = 0; k < count; k++) {
+        int i = hebrew_locate(&from, dates[k]);
+        int day = dates[k] - from.month_start[i] + 1;
+        int year;
+        hebrew_from_month_number(hebrew_months_elapsed(from.year) + i + n, &year, &i);
+        results[k] = hebrew_day_in(&to, year, i, day);
+    }
+}
+
+void hebrew_add_years_n(const int *restrict dates, int *restrict results,
+                        size_t count, int n)
+{
+    struct HebrewYearInfo from = { 0 }, to = { 0 };
+    for (size_t k = 0; k < count; k++) {
+        int i = hebrew_locate(&from, dates[k]);
+        int day = dates[k] - from.month_start[i] + 1;
+        int year = from.year + n;
+        int month = hebrew_same_month(hebrew_month_from_index(from.year, i),
+                                      from.year, year);
+        results[k] = hebrew_day_in(&to, year, hebrew_month_index(year, month), day);
+    }
+}
+
+#pragma mark Chinese
+
+/* The true new moon is within a day or so of the mean, so the month
+   starting nearest s + n mean months is the one n months on from the
+   month starting on s. */
+static int chinese_month_estimate(int start, int n)
+{
+    return start + (int)lround(n * MEAN_SYNODIC_MONTH);
+}
+
+int chinese_add_months(int date, int n)
+{
+    int start = chinese_new_moon_before(date + 1);
+    int target = chinese_new_moon_before(chinese_month_estimate(start, n) + 15);
+    int length = chinese_new_moon_on_or_after(target + 1) - target;
+    return target + min(date - start + 1, length) - 1;
+}
+
+int chinese_months_between(int date1, int date2)
+{
+    int start1 = chinese_new_moon_before(date1 + 1);
+    int start2 = chinese_new_moon_before(date2 + 1);
+    int months = (int)lround((start2 - start1) / MEAN_SYNODIC_MONTH);
+    int day1 = date1 - start1 + 1, day2 = date2 - start2 + 1;
+    /* The length of the second month only matters if day1 is later. */
+    int length2 = day1 > day2 ? chinese_new_moon_on_or_after(start2 + 1) - start2 : day1;
+    return whole_months(0, day1, months, day2, length2);
+}
+
+static bool chinese_year_has(const struct ChineseYearInfo *info, int date)
+{
+    return info->months > 0 && date >= info->new_year &&
+        date < info->month_start[info->months];
+}
+
+/* Make info the year of date, and return the index of date's month. */
+static int chinese_locate(struct ChineseYearInfo *info, int date)
+{
+    if (!chinese_year_has(info, date)) chinese_year_info(date, info);
+    int i = 0;
+    while (date >= info->month_start[i + 1]) i++;
+    return i;
+}
+
+static int chinese_day_in(const struct ChineseYearInfo *info, int i, int day)
+{
+    int length = info->month_start[i + 1] - info->month_start[i];
+    return info->month_start[i] + min(day, length) - 1;
+}
+
+void chinese_add_months_n(const int *restrict dates, int *restrict results,
+                          size_t count, int n)
+{
+    struct ChineseYearInfo from = { .months = 0 }, to = { .months = 0 };
+    for (size_t k = 0; k < count; k++) {
+        int i = chinese_locate(&from, dates[k]);
+        int day = dates[k] - from.month_start[i] + 1;
+        /* Halfway into the estimated month is surely in the right one. */
+        i = chinese_locate(&to, chinese_month_estimate(from.month_start[i], n) + 14);
+        results[k] = chinese_day_in(&to, i, day);
+    }
+}
+
+void chinese_add_years_n(const int *restrict dates, int *restrict results,
+                         size_t count, int n)
+{
+    struct ChineseYearInfo from = { .months = 0 }, to = { .months = 0 };
+    for (size_t k = 0; k < count; k++) {
+        int i = chinese_locate(&from, dates[k]);
+        int day = dates[k] - from.month_start[i] + 1;
+        bool leap = i == from.leap_month;
+        int month = (from.leap_month < 0 || i < from.leap_month) ? i + 1 : i;
+
+        int year = 60 * from.cycle + from.year + n;
+        if (to.months == 0 || 60 * to.cycle + to.year != year)
+            chinese_year_info(from.new_year + (int)lround(n * MEAN_TROPICAL_YEAR) + 180, &to);
+
+        if (leap && month == to.leap_month) i = month;
+        else if (to.leap_month < 0 || month <= to.leap_month) i = month - 1;
+        else i = month;
+        results[k] = chinese_day_in(&to, i, day);
+    }
+}
+
+int chinese_add_years(int date, int n)
+{
+    int result;
+    chinese_add_years_n(&date, &result, 1, n);
+    return result;
+}
@@ -0,0 +1,74 @@
+#ifndef DATEMATH_H
+#define DATEMATH_H
+
+#include <stddef.h>
+#include "calendar.h"
+
+/* Adding months and years to dates, and counting the months between them.
+ *
+ * add_months counts the months of the calendar, leap months included, so
+ * twelve Hebrew or Chinese months on needn't be the same month next year.
+ * add_years keeps the month and moves the year:
+ *   Hebrew: as in hebrew_birthday, the last month of the year stays the
+ *   last, so Adar becomes Adar II in a leap year and Adar II becomes Adar
+ *   in a common one. Adar I becomes Adar.
+ *   Chinese: a leap month becomes the ordinary month of the same number
+ *   in a year without that leap month.
+ * Either way, a day past the end of the month it lands in becomes that
+ * month's last day: January 31 plus a month is February 28 or 29, and
+ * 30 Heshvan plus a year may be 29 Heshvan.
+ *
+ * months_between counts whole months from one date to another: the
+ * largest k with add_months(from, k) on or before to, or when to is
+ * before from, the smallest k with add_months(from, k) on or after it.
+ *
+ * None of these steps through the months in between. The Chinese ones
+ * take and return fixed dates, since the components cost astronomy to
+ * convert anyway. The _n forms take and return fixed dates, adding the
+ * same amount to each; they keep the year they last worked out, so they're
+ * quickest on dates that are sorted or clustered. */
+
+void gregorian_add_months(int year, int month, int day, int n,
+                          int *ryear, int *rmonth, int *rday);
+void gregorian_add_years(int year, int month, int day, int n,
+                         int *ryear, int *rmonth, int *rday);
+int gregorian_months_between(int year1, int month1, int day1,
+                             int year2, int month2, int day2) __attribute__((const));
+void gregorian_add_months_n(const int *dates, int *results, size_t count, int n);
+void gregorian_add_years_n(const int *dates, int *results, size_t count, int n);
+
+void julian_add_months(int year, int month, int day, int n,
+                       int *ryear, int *rmonth, int *rday);
+void julian_add_years(int year, int month, int day, int n,
+                      int *ryear, int *rmonth, int *rday);
+int julian_months_between(int year1, int month1, int day1,
+                          int year2, int month2, int day2) __attribute__((const));
+void julian_add_months_n(const int *dates, int *results, size_t count, int n);
+void julian_add_years_n(const int *dates, int *results, size_t count, int n);
+
+void islamic_add_months(int year, int month, int day, int n,
+                        int *ryear, int *rmonth, int *rday);
+void islamic_add_years(int year, int month, int day, int n,
+                       int *ryear, int *rmonth, int *rday);
+int islamic_months_between(int year1, int month1, int day1,
+                           int year2, int month2, int day2) __attribute__((const));
+void islamic_add_months_n(const int *dates, int *results, size_t count, int n);
+void islamic_add_years_n(const int *dates, int *results, size_t count, int n);
+
+void hebrew_add_months(int year, int month, int day, int n,
+                       int *ryear, int *rmonth, int *rday);
+void hebrew_add_years(int year, int month, int day, int n,
+                      int *ryear, int *rmonth, int *rday);
+int hebrew_months_between(int year1, int month1, int day1,
+                          int year2, int month2, int day2) __attribute__((const));
+void hebrew_add_months_n(const int *dates, int *results, size_t count, int n);
+void hebrew_add_years_n(const int *dates, int *results, size_t count, int n);
+
+/* Not const, as they find new moons through memo.h's tables. */
+int chinese_add_months(int date, int n);
+int chinese_add_years(int date, int n);
+int chinese_months_between(int date1, int date2);
+void chinese_add_months_n(const int *dates, int *results, size_t count, int n);
+void chinese_add_years_n(const int *dates, int *results, size_t count, int n);
+
+#endif
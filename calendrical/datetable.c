@@ -0,0 +1,39 @@
+/*
+ *  datetable.c
+ *  Fixed dates kept for a run of years or months.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "datetable.h"
+
+bool date_table_reserve(struct DateTable *table, int lo, int hi)
+{
+    if (hi < lo) return true;
+    if (table->count > 0) {
+        int last = table->first + table->count - 1;
+        if (lo >= table->first && hi <= last) return true;
+        if (lo > table->first) lo = table->first;
+        if (hi < last) hi = last;
+    }
+    int count = hi - lo + 1;
+    int *dates = malloc(count * sizeof(int));
+    if (dates == NULL) return false;
+    for (int i = 0; i < count; i++) dates[i] = DATE_TABLE_UNKNOWN;
+    if (table->count > 0) {
+        memcpy(dates + (table->first - lo), table->dates, table->count * sizeof(int));
+        free(table->dates);
+    }
+    table->dates = dates;
+    table->first = lo;
+    table->count = count;
+    return true;
+}
+
+void date_table_free(struct DateTable *table)
+{
+    free(table->dates);
+    table->dates = NULL;
+    table->first = 0;
+    table->count = 0;
+}
@@ -0,0 +1,35 @@
+#ifndef DATETABLE_H
+#define DATETABLE_H
+
+#include <stdbool.h>
+#include <limits.h>
+
+/* Fixed dates kept for a run of consecutive numbers (elapsed months,
+ * elapsed years), as the caches in crescent.c and nowruz.c hold them.
+ *
+ * The table only grows and fills when its owner precomputes; looking a
+ * date up never writes, and gives DATE_TABLE_UNKNOWN for numbers that
+ * weren't filled, which the caller then works out without keeping. */
+
+#define DATE_TABLE_UNKNOWN INT_MIN
+
+struct DateTable {
+    int first;          /* number of dates[0] */
+    int count;
+    int *dates;         /* DATE_TABLE_UNKNOWN where not filled */
+};
+
+/* Make room for numbers lo through hi as well as those already there.
+   New slots are DATE_TABLE_UNKNOWN. Returns false if memory can't be
+   allocated, leaving the table as it was. */
+bool date_table_reserve(struct DateTable *table, int lo, int hi);
+void date_table_free(struct DateTable *table);
+
+static inline int date_table_get(const struct DateTable *table, int n)
+{
+    if (n < table->first || n - table->first >= table->count)
+        return DATE_TABLE_UNKNOWN;
+    return table->dates[n - table->first];
+}
+
+#endif
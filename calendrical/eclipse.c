@@ -0,0 +1,215 @@
+/*
+ *  eclipse.c
+ *  Solar and lunar eclipses by lunation, scanned on several threads.
+ */
+
+#include <stdlib.h>
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "eclipse.h"
+
+#define torad(d) ((d) * (M_PI / 180.0))
+
+/* As in lunation.c. */
+#define MEAN_SYNODIC_MONTH 29.530588853
+#define MEAN_NEW_MOON_0 (730125.59765 - 24724 * MEAN_SYNODIC_MONTH)
+#define MEEUS_OFFSET 24724
+
+#define BLOCK 1000              /* lunations a thread takes at a time, about 80 years */
+
+static int mean_lunation(double t)
+{
+    return (int)floor((t - MEAN_NEW_MOON_0) / MEAN_SYNODIC_MONTH);
+}
+
+#pragma mark One lunation
+
+bool eclipse_in_lunation(int n, bool lunar, struct Eclipse *eclipse)
+{
+    double k = n - MEEUS_OFFSET + (lunar ? 0.5 : 0);
+    double T = k / 1236.85;
+    double T2 = T * T, T3 = T2 * T, T4 = T3 * T;
+
+    /* Too far from a node for any eclipse. */
+    double F = torad(160.7108 + 390.67050284 * k - 0.0016118 * T2 -
+                     0.00000227 * T3 + 0.000000011 * T4);
+    if (fabs(sin(F)) > 0.36) return false;
+
+    double jde = 2451550.09766 + 29.530588861 * k + 0.00015437 * T2 -
+        0.000000150 * T3 + 0.00000000073 * T4;
+    double M = torad(2.5534 + 29.10535670 * k - 0.0000014 * T2 - 0.00000011 * T3);
+    double Mp = torad(201.5643 + 385.81693528 * k + 0.0107582 * T2 +
+                      0.00001238 * T3 - 0.000000058 * T4);
+    double Omega = torad(124.7746 - 1.56375588 * k + 0.0020672 * T2 + 0.00000215 * T3);
+    double E = 1 - 0.002516 * T - 0.0000074 * T2;
+    double F1 = F - torad(0.02665) * sin(Omega);
+    double A1 = torad(299.77 + 0.107408 * k - 0.009173 * T2);
+
+    jde += (lunar ? -0.4065 : -0.4075) * sin(Mp) + (lunar ? 0.1727 : 0.1721) * E * sin(M) +
+        0.0161 * sin(2 * Mp) - 0.0097 * sin(2 * F1) + 0.0073 * E * sin(Mp - M) -
+        0.0050 * E * sin(Mp + M) - 0.0023 * sin(Mp - 2 * F1) + 0.0021 * E * sin(2 * M) +
+        0.0012 * sin(Mp + 2 * F1) + 0.0006 * E * sin(2 * Mp + M) - 0.0004 * sin(3 * Mp) -
+        0.0003 * E * sin(M + 2 * F1) + 0.0003 * sin(A1) - 0.0002 * E * sin(M - 2 * F1) -
+        0.0002 * E * sin(2 * Mp - M) - 0.0002 * sin(Omega);
+
+    double P = 0.2070 * E * sin(M) + 0.0024 * E * sin(2 * M) - 0.0392 * sin(Mp) +
+        0.0116 * sin(2 * Mp) - 0.0073 * E * sin(Mp + M) + 0.0067 * E * sin(Mp - M) +
+        0.0118 * sin(2 * F1);
+    double Q = 5.2207 - 0.0048 * E * cos(M) + 0.0020 * E * cos(2 * M) - 0.3299 * cos(Mp) -
+        0.0060 * E * cos(Mp + M) + 0.0041 * E * cos(Mp - M);
+    double W = fabs(cos(F1));
+    double gamma = (P * cos(F1) + Q * sin(F1)) * (1 - 0.0048 * W);
+    double u = 0.0059 + 0.0046 * E * cos(M) - 0.0182 * cos(Mp) + 0.0004 * cos(2 * Mp) -
+        0.0005 * cos(M + Mp);
+
+    struct Eclipse e = { n, lunar, false, ECLIPSE_PARTIAL,
+                         universal_from_dynamical(moment_from_jd(jde)), gamma, 0 };
+    if (lunar) {
+        double penumbral = (1.5573 + u - fabs(gamma)) / 0.5450;
+        double umbral = (1.0128 - u - fabs(gamma)) / 0.5450;
+        if (penumbral <= 0) return false;
+        e.type = umbral >= 1 ? ECLIPSE_TOTAL : umbral > 0 ? ECLIPSE_PARTIAL : ECLIPSE_PENUMBRAL;
+        e.magnitude = umbral > 0 ? umbral : penumbral;
+    } else {
+        if (fabs(gamma) > 1.5433 + u) return false;
+        e.central = fabs(gamma) < 0.9972;
+        if (e.central || fabs(gamma) < 0.9972 + fabs(u)) {
+            /* The umbra or its extension touches the Earth. u is the
+               umbra's radius on the fundamental plane, and omega how much
+               it grows to where the axis meets the Earth's surface. */
+            double omega = 0.00464 * sqrt(fmax(0, 1 - gamma * gamma));
+            if (u < 0) e.type = ECLIPSE_TOTAL;
+            else if (e.central && u < omega) e.type = ECLIPSE_HYBRID;
+            else e.type = ECLIPSE_ANNULAR;
+            e.magnitude = (0.5461 + 2 * omega) / (0.5461 + 2 * u);
+        } else {
+            e.magnitude = (1.5433 + u - fabs(gamma)) / (0.5461 + 2 * u);
+        }
+    }
+    if (eclipse) *eclipse = e;
+    return true;
+}
+
+/* The eclipses of lunations lo through hi from moment from up to to. There
+   are at most two a lunation. */
+static size_t scan_lunations(int lo, int hi, double from, double to,
+                             struct Eclipse *found, size_t max)
+{
+    size_t count = 0;
+    for (int n = lo; n <= hi && count < max; n++) {
+        for (int lunar = 0; lunar <= 1 && count < max; lunar++) {
+            struct Eclipse e;
+            if (eclipse_in_lunation(n, lunar, &e) && e.time >= from && e.time < to)
+                found[count++] = e;
+        }
+    }
+    return count;
+}
+
+size_t eclipses(double from, double to, struct Eclipse *found, size_t max)
+{
+    /* The true syzygy is within a day or so of the mean one, but allow a
+       lunation each side, as lunation.c does. */
+    return scan_lunations(mean_lunation(from) - 1, mean_lunation(to) + 1, from, to,
+                          found, max);
+}
+
+#pragma mark Scanning
+
+/* Threads take blocks in turn, and whichever finishes the block due next
+   hands it and any finished ones after it to the sink. */
+struct scan_job {
+    pthread_mutex_t lock;
+    int first;              /* lunations first through last */
+    int last;
+    double from;
+    double to;
+    int blocks;
+    int next;               /* block to take next */
+    int delivered;          /* blocks handed to the sink */
+    struct Eclipse **found; /* for each block finished but not delivered */
+    size_t *counts;
+    bool *finished;
+    bool failed;
+    EclipseSink sink;
+    void *context;
+};
+
+static void *scan_thread(void *arg)
+{
+    struct scan_job *job = arg;
+    for (;;) {
+        pthread_mutex_lock(&job->lock);
+        int b = job->next < job->blocks && !job->failed ? job->next++ : -1;
+        pthread_mutex_unlock(&job->lock);
+        if (b < 0) break;
+
+        int lo = job->first + b * BLOCK;
+        int hi = job->last - lo < BLOCK ? job->last : lo + BLOCK - 1;
+        size_t max = 2 * (size_t)(hi - lo + 1);
+        struct Eclipse *found = malloc(max * sizeof(*found));
+        size_t count = found ? scan_lunations(lo, hi, job->from, job->to, found, max) : 0;
+
+        pthread_mutex_lock(&job->lock);
+        if (found == NULL) job->failed = true;
+        job->found[b] = found;
+        job->counts[b] = count;
+        job->finished[b] = true;
+        while (job->delivered < job->blocks && job->finished[job->delivered]) {
+            int d = job->delivered++;
+            if (!job->failed && job->counts[d] > 0)
+                job->sink(job->found[d], job->counts[d], job->context);
+            free(job->found[d]);
+            job->found[d] = NULL;
+        }
+        pthread_mutex_unlock(&job->lock);
+    }
+    return NULL;
+}
+
+bool eclipse_scan(double from, double to, int threads, EclipseSink sink, void *context)
+{
+    struct scan_job job;
+    job.first = mean_lunation(from) - 1;
+    job.last = mean_lunation(to) + 1;
+    if (!(to > from)) return true;
+    job.from = from;
+    job.to = to;
+    job.blocks = (job.last - job.first) / BLOCK + 1;
+    job.next = 0;
+    job.delivered = 0;
+    job.failed = false;
+    job.sink = sink;
+    job.context = context;
+
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+    if (threads > job.blocks) threads = job.blocks;
+
+    job.found = calloc(job.blocks, sizeof(*job.found));
+    job.counts = calloc(job.blocks, sizeof(*job.counts));
+    job.finished = calloc(job.blocks, sizeof(*job.finished));
+    pthread_t *ids = malloc(threads * sizeof(*ids));
+    bool *started = malloc(threads * sizeof(*started));
+    bool ok = job.found && job.counts && job.finished && ids && started;
+
+    if (ok) {
+        pthread_mutex_init(&job.lock, NULL);
+        for (int i = 1; i < threads; i++)
+            started[i] = pthread_create(&ids[i], NULL, scan_thread, &job) == 0;
+        scan_thread(&job);
+        for (int i = 1; i < threads; i++)
+            if (started[i]) pthread_join(ids[i], NULL);
+        pthread_mutex_destroy(&job.lock);
+        ok = !job.failed;
+    }
+    free(job.found);
+    free(job.counts);
+    free(job.finished);
+    free(ids);
+    free(started);
+    return ok;
+}
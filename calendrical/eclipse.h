@@ -0,0 +1,62 @@
+#ifndef ECLIPSE_H
+#define ECLIPSE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "calendar.h"
+
+/* Solar and lunar eclipses, lunation by lunation, by the method of Meeus,
+ * Astronomical Algorithms, chapter 54.
+ *
+ * A new or full moon can only be eclipsed when the Moon is near a node of
+ * its orbit, so most are rejected by the Moon's argument of latitude
+ * alone, at the cost of a sine. The rest get the periodic terms for the
+ * time of greatest eclipse and for gamma, the least distance of the axis
+ * of the Moon's (or the Earth's) shadow from the centre of the Earth (or
+ * the Moon), which decides the kind of eclipse and its magnitude.
+ *
+ * Times are good to a few minutes, and eclipses that only just happen or
+ * just fail to may be misjudged, so take them as candidates to be worked
+ * out exactly. */
+
+enum EclipseType {
+    ECLIPSE_PARTIAL,
+    ECLIPSE_ANNULAR,            /* solar only */
+    ECLIPSE_TOTAL,
+    ECLIPSE_HYBRID,             /* solar: annular along part of the path */
+    ECLIPSE_PENUMBRAL           /* lunar only */
+};
+
+struct Eclipse {
+    int lunation;               /* the n of nth_new_moon; a lunar eclipse is at its full moon */
+    bool lunar;
+    bool central;               /* solar: the shadow's axis touches the Earth */
+    enum EclipseType type;
+    double time;                /* moment of greatest eclipse, universal time */
+    double gamma;               /* in radii of the Earth; negative south */
+    double magnitude;
+};
+
+/* The magnitude of a solar eclipse is the fraction of the Sun's diameter
+   covered at greatest eclipse for a partial one, and the ratio of the
+   apparent diameters of the Moon and Sun, from the radii of the shadows,
+   for the others. Of a lunar eclipse it's the umbral magnitude, or the
+   penumbral one if the Moon misses the umbra. */
+
+/* The eclipse at lunation n's new moon, or at its full moon if lunar.
+   Returns false if there is none. */
+bool eclipse_in_lunation(int n, bool lunar, struct Eclipse *eclipse);
+
+/* Up to max of the eclipses from moment from up to to, in order. Returns
+   how many were written. */
+size_t eclipses(double from, double to, struct Eclipse *found, size_t max);
+
+/* All the eclipses from moment from up to to, handed to sink in order, a
+   block of lunations at a time, on several threads (as many as there are
+   processors if threads is 0 or less). sink is called from one thread at
+   a time, but not always the same one. Returns false if memory couldn't
+   be allocated, in which case sink has had only some of them. */
+typedef void (*EclipseSink)(const struct Eclipse *eclipses, size_t count, void *context);
+bool eclipse_scan(double from, double to, int threads, EclipseSink sink, void *context);
+
+#endif
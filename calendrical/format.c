@@ -0,0 +1,342 @@
+/*
+ *  format.c
+ *  Dates as text, written straight into the caller's buffer.
+ */
+
+#include <stdbool.h>
+#include "format.h"
+
+#pragma mark Pieces
+
+static const char digit_pairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/* v in decimal, zero-padded to at least width digits. */
+static char *put_unsigned(char *p, unsigned v, int width)
+{
+    char tmp[10];
+    int n = 0;
+    while (v >= 100) {
+        unsigned q = v / 100;
+        const char *pair = &digit_pairs[(v - q * 100) * 2];
+        tmp[n++] = pair[1];
+        tmp[n++] = pair[0];
+        v = q;
+    }
+    if (v >= 10) {
+        tmp[n++] = digit_pairs[v * 2 + 1];
+        tmp[n++] = digit_pairs[v * 2];
+    } else {
+        tmp[n++] = (char)('0' + v);
+    }
+    while (n < width) tmp[n++] = '0';
+    while (n > 0) *p++ = tmp[--n];
+    return p;
+}
+
+static char *put_int(char *p, int v, int width)
+{
+    if (v >= 0) return put_unsigned(p, (unsigned)v, width);
+    *p++ = '-';
+    return put_unsigned(p, 0u - (unsigned)v, width);
+}
+
+static char *put_string(char *p, const char *s)
+{
+    while (*s) *p++ = *s++;
+    return p;
+}
+
+static const char *name(char *const *names, int count, int i)
+{
+    return i >= 1 && i <= count && names[i] ? names[i] : "?";
+}
+
+static size_t finish(char *buf, char *p)
+{
+    *p = '\0';
+    return (size_t)(p - buf);
+}
+
+#pragma mark Names
+
+char *HebrewMonths[] = { NULL, "Nisan", "Iyyar", "Sivan", "Tammuz", "Av",
+    "Elul", "Tishri", "Marheshvan", "Kislev", "Tevet", "Shevat", "Adar", "Adar II" };
+
+char *IslamicMonths[] = { NULL, "Muharram", "Safar", "Rabi I", "Rabi II",
+    "Jumada I", "Jumada II", "Rajab", "Sha'ban", "Ramadan", "Shawwal",
+    "Dhu al-Qa'da", "Dhu al-Hijja" };
+
+char *ChineseNumerals[] = { NULL, "一", "二", "三", "四", "五", "六", "七",
+    "八", "九", "十" };
+
+#pragma mark Dates
+
+size_t format_gregorian(char *buf, int year, int month, int day)
+{
+    char *p = buf;
+    if (year > 9999) *p++ = '+';
+    p = put_int(p, year, 4);
+    *p++ = '-';
+    p = put_int(p, month, 2);
+    *p++ = '-';
+    p = put_int(p, day, 2);
+    return finish(buf, p);
+}
+
+size_t format_iso(char *buf, int year, int week, int day)
+{
+    char *p = buf;
+    if (year > 9999) *p++ = '+';
+    p = put_int(p, year, 4);
+    *p++ = '-';
+    *p++ = 'W';
+    p = put_int(p, week, 2);
+    *p++ = '-';
+    p = put_int(p, day, 1);
+    return finish(buf, p);
+}
+
+size_t format_hebrew(char *buf, int year, int month, int day)
+{
+    char *p = put_int(buf, day, 1);
+    *p++ = ' ';
+    p = put_string(p, month == 12 && hebrew_leap_year(year) ? "Adar I" :
+                      name(HebrewMonths, 13, month));
+    *p++ = ' ';
+    p = put_int(p, year, 1);
+    return finish(buf, p);
+}
+
+size_t format_islamic(char *buf, int year, int month, int day)
+{
+    char *p = put_int(buf, day, 1);
+    *p++ = ' ';
+    p = put_string(p, name(IslamicMonths, 12, month));
+    *p++ = ' ';
+    p = put_int(p, year, 1);
+    return finish(buf, p);
+}
+
+size_t format_mayan_long_count(char *buf, int baktun, int katun, int tun,
+                               int uinal, int kin)
+{
+    char *p = put_int(buf, baktun, 1);
+    *p++ = '.';
+    p = put_int(p, katun, 1);
+    *p++ = '.';
+    p = put_int(p, tun, 1);
+    *p++ = '.';
+    p = put_int(p, uinal, 1);
+    *p++ = '.';
+    p = put_int(p, kin, 1);
+    return finish(buf, p);
+}
+
+size_t format_mayan_tzolkin(char *buf, int number, int tzolkin_name)
+{
+    char *p = put_int(buf, number, 1);
+    *p++ = ' ';
+    p = put_string(p, name(TzolkinNames, 20, tzolkin_name));
+    return finish(buf, p);
+}
+
+size_t format_mayan_haab(char *buf, int month, int day)
+{
+    char *p = put_int(buf, day, 1);
+    *p++ = ' ';
+    p = put_string(p, name(HaabMonths, 19, month));
+    return finish(buf, p);
+}
+
+static char *put_sexagesimal(char *p, int year)
+{
+    int stem, branch;
+    chinese_sexagesimal_name(year, &stem, &branch);
+    p = put_string(p, stem >= 1 && stem <= 10 ? Stems[stem].chinese : "?");
+    return put_string(p, branch >= 1 && branch <= 12 ? Branches[branch].chinese : "?");
+}
+
+size_t format_chinese_year(char *buf, int year)
+{
+    int stem, branch;
+    chinese_sexagesimal_name(year, &stem, &branch);
+    char *p = put_sexagesimal(buf, year);
+    p = put_string(p, " Year of the ");
+    p = put_string(p, branch >= 1 && branch <= 12 ? Branches[branch].zodiac : "?");
+    return finish(buf, p);
+}
+
+/* Months are 正月, 二月 ... 十二月; days 初一 to 初十, 十一 to 十九, 二十,
+   廿一 to 廿九 and 三十. */
+size_t format_chinese(char *buf, struct ChineseDate cdate)
+{
+    char *p = put_sexagesimal(buf, cdate.year);
+    p = put_string(p, "年");
+    if (cdate.leap) p = put_string(p, "閏");
+    if (cdate.month == 1) p = put_string(p, "正");
+    else if (cdate.month >= 11 && cdate.month <= 12) {
+        p = put_string(p, "十");
+        p = put_string(p, ChineseNumerals[cdate.month - 10]);
+    }
+    else p = put_string(p, name(ChineseNumerals, 10, cdate.month));
+    p = put_string(p, "月");
+
+    int day = cdate.day;
+    if (day >= 1 && day <= 10) {
+        p = put_string(p, "初");
+        p = put_string(p, ChineseNumerals[day]);
+    } else if (day >= 11 && day <= 19) {
+        p = put_string(p, "十");
+        p = put_string(p, ChineseNumerals[day - 10]);
+    } else if (day == 20 || day == 30) {
+        p = put_string(p, day == 20 ? "二十" : "三十");
+    } else if (day >= 21 && day <= 29) {
+        p = put_string(p, "廿");
+        p = put_string(p, ChineseNumerals[day - 20]);
+    } else {
+        p = put_string(p, "?");
+    }
+    return finish(buf, p);
+}
+
+#pragma mark Batches
+
+/* One date's text at buf, from its fixed date. */
+typedef size_t (*FormatFixed)(char *buf, int date, void *state);
+
+static size_t format_each(const int *dates, size_t count, char separator,
+                          char *out, size_t size, size_t *formatted,
+                          FormatFixed one, void *state)
+{
+    size_t used = 0, i = 0;
+    for (; i < count && size - used > FORMAT_MAX; i++) {
+        used += one(out + used, dates[i], state);
+        out[used++] = separator;
+    }
+    if (size > 0) out[used] = '\0';
+    if (formatted) *formatted = i;
+    return used;
+}
+
+static size_t gregorian_fixed(char *buf, int date, void *state)
+{
+    int year, month, day;
+    (void)state;
+    gregorian_from_fixed(date, &year, &month, &day);
+    return format_gregorian(buf, year, month, day);
+}
+
+static size_t iso_fixed(char *buf, int date, void *state)
+{
+    int year, week, day;
+    (void)state;
+    iso_from_fixed(date, &year, &week, &day);
+    return format_iso(buf, year, week, day);
+}
+
+/* hebrew_from_fixed is slow enough to matter here, so dates in the same
+   year, Tishri to Tishri, share its month starts. */
+struct HebrewState {
+    bool valid;
+    struct HebrewYearInfo info;
+};
+
+static size_t hebrew_fixed(char *buf, int date, void *state)
+{
+    struct HebrewState *s = state;
+    struct HebrewYearInfo *info = &s->info;
+    if (!s->valid || date < info->month_start[0] ||
+        date >= info->month_start[info->months]) {
+        int year = info->year + 1;
+        if (!s->valid || date < info->month_start[info->months] ||
+            date >= info->month_start[info->months] + 353)
+            hebrew_from_fixed(date, &year, NULL, NULL);
+        hebrew_year_info(year, info);
+        s->valid = true;
+    }
+    int i = 0;
+    while (date >= info->month_start[i + 1]) i++;
+    int month = i < info->months - 6 ? i + 7 : i - info->months + 7;
+    return format_hebrew(buf, info->year, month, date - info->month_start[i] + 1);
+}
+
+static size_t islamic_fixed(char *buf, int date, void *state)
+{
+    int year, month, day;
+    (void)state;
+    islamic_from_fixed(date, &year, &month, &day);
+    return format_islamic(buf, year, month, day);
+}
+
+static size_t mayan_fixed(char *buf, int date, void *state)
+{
+    int baktun, katun, tun, uinal, kin, number, tzolkin_name, month, day;
+    (void)state;
+    mayan_long_count_from_fixed(date, &baktun, &katun, &tun, &uinal, &kin);
+    mayan_tzolkin_from_fixed(date, &number, &tzolkin_name);
+    mayan_haab_from_fixed(date, &month, &day);
+    size_t n = format_mayan_long_count(buf, baktun, katun, tun, uinal, kin);
+    buf[n++] = ' ';
+    n += format_mayan_tzolkin(buf + n, number, tzolkin_name);
+    buf[n++] = ' ';
+    return n + format_mayan_haab(buf + n, month, day);
+}
+
+struct ChineseState {
+    bool valid;
+    struct ChineseYearInfo info;
+};
+
+static size_t chinese_fixed(char *buf, int date, void *state)
+{
+    struct ChineseState *s = state;
+    if (!s->valid || date < s->info.new_year ||
+        date >= s->info.month_start[s->info.months]) {
+        chinese_year_info(date, &s->info);
+        s->valid = true;
+    }
+    struct ChineseDate cdate;
+    chinese_from_fixed_with(&s->info, date, &cdate);
+    return format_chinese(buf, cdate);
+}
+
+size_t format_gregorian_n(const int *dates, size_t count, char separator,
+                          char *out, size_t size, size_t *formatted)
+{
+    return format_each(dates, count, separator, out, size, formatted, gregorian_fixed, NULL);
+}
+
+size_t format_iso_n(const int *dates, size_t count, char separator,
+                    char *out, size_t size, size_t *formatted)
+{
+    return format_each(dates, count, separator, out, size, formatted, iso_fixed, NULL);
+}
+
+size_t format_hebrew_n(const int *dates, size_t count, char separator,
+                       char *out, size_t size, size_t *formatted)
+{
+    struct HebrewState state = { false };
+    return format_each(dates, count, separator, out, size, formatted, hebrew_fixed, &state);
+}
+
+size_t format_islamic_n(const int *dates, size_t count, char separator,
+                        char *out, size_t size, size_t *formatted)
+{
+    return format_each(dates, count, separator, out, size, formatted, islamic_fixed, NULL);
+}
+
+size_t format_mayan_n(const int *dates, size_t count, char separator,
+                      char *out, size_t size, size_t *formatted)
+{
+    return format_each(dates, count, separator, out, size, formatted, mayan_fixed, NULL);
+}
+
+size_t format_chinese_n(const int *dates, size_t count, char separator,
+                        char *out, size_t size, size_t *formatted)
+{
+    struct ChineseState state = { false };
+    return format_each(dates, count, separator, out, size, formatted, chinese_fixed, &state);
+}
@@ -0,0 +1,63 @@
+#ifndef FORMAT_H
+#define FORMAT_H
+
+#include <stddef.h>
+#include "calendar.h"
+
+/* Dates as text, without printf, locales or allocation.
+ *
+ * Each formatter writes at most FORMAT_MAX bytes into buf, the text and a
+ * terminating NUL, and returns the length of the text. Fields are written
+ * as given; nothing is checked beyond indexing the name tables, and a
+ * month or day name out of range is written as "?".
+ *
+ * The _n functions convert fixed dates and format them one after another
+ * into out, each followed by separator, then a NUL. They stop before a
+ * date that might not fit in size bytes, so size must be more than
+ * FORMAT_MAX for any to be written, and return the length of the text;
+ * if formatted isn't NULL, *formatted is how many dates were written. */
+
+#define FORMAT_MAX 64
+
+/* Indexed from 1, like HaabMonths and TzolkinNames. Month 12 of a Hebrew
+   leap year is written Adar I. ChineseNumerals runs from 一 to 十. */
+extern char *HebrewMonths[];
+extern char *IslamicMonths[];
+extern char *ChineseNumerals[];
+
+/* 2024-03-09; years before 0 or after 9999 get a sign, as in ISO 8601. */
+size_t format_gregorian(char *buf, int year, int month, int day);
+/* 2024-W10-6 */
+size_t format_iso(char *buf, int year, int week, int day);
+/* 29 Adar I 5784 */
+size_t format_hebrew(char *buf, int year, int month, int day);
+/* 28 Sha'ban 1445 */
+size_t format_islamic(char *buf, int year, int month, int day);
+/* 13.0.11.7.19 */
+size_t format_mayan_long_count(char *buf, int baktun, int katun, int tun,
+                               int uinal, int kin);
+/* 7 Ahau */
+size_t format_mayan_tzolkin(char *buf, int number, int name);
+/* 3 Cumku */
+size_t format_mayan_haab(char *buf, int month, int day);
+/* 甲辰 Year of the Dragon, for the year of the cycle */
+size_t format_chinese_year(char *buf, int year);
+/* 甲辰年閏四月初五 */
+size_t format_chinese(char *buf, struct ChineseDate cdate);
+
+size_t format_gregorian_n(const int *dates, size_t count, char separator,
+                          char *out, size_t size, size_t *formatted);
+size_t format_iso_n(const int *dates, size_t count, char separator,
+                    char *out, size_t size, size_t *formatted);
+size_t format_hebrew_n(const int *dates, size_t count, char separator,
+                       char *out, size_t size, size_t *formatted);
+size_t format_islamic_n(const int *dates, size_t count, char separator,
+                        char *out, size_t size, size_t *formatted);
+/* The long count, tzolkin and haab, with spaces between. */
+size_t format_mayan_n(const int *dates, size_t count, char separator,
+                      char *out, size_t size, size_t *formatted);
+/* Dates in the same year share its months, worked out once. */
+size_t format_chinese_n(const int *dates, size_t count, char separator,
+                        char *out, size_t size, size_t *formatted);
+
+#endif
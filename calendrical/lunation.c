@@ -0,0 +1,92 @@
+/*
+ *  lunation.c
+ *  Lunation numbers, with a table of new moons for fast lookup.
+ */
+
+#include <stdlib.h>
+#include <math.h>
+#include "lunation.h"
+
+/* As in nth_new_moon: the mean new moon of lunation n. */
+#define MEAN_SYNODIC_MONTH 29.530588853
+#define MEAN_NEW_MOON_0 (730125.59765 - 24724 * MEAN_SYNODIC_MONTH)
+
+#define MEEUS_OFFSET 24724      /* number of Meeus's lunation 0 */
+#define BROWN_OFFSET 23771      /* number of Brown's lunation 0 */
+
+static double mean_new_moon(int n)
+{
+    return MEAN_NEW_MOON_0 + n * MEAN_SYNODIC_MONTH;
+}
+
+/* The lunation whose mean new moon is at or before t. The true new moon
+   is within about a day of the mean one, so this is right or one off,
+   except far enough from the present for ΔT to add up. */
+static int mean_lunation(double t)
+{
+    return (int)floor((t - MEAN_NEW_MOON_0) / MEAN_SYNODIC_MONTH);
+}
+
+struct LunationTable *lunation_table_create(double from, double to)
+{
+    struct LunationTable *table = malloc(sizeof(*table));
+    if (table == NULL) return NULL;
+    /* One lunation of margin each side covers the one-off estimates. */
+    table->first = mean_lunation(from) - 1;
+    table->count = to < from ? 0 : mean_lunation(to) + 1 - table->first + 1;
+    table->offsets = malloc((table->count + 1) * sizeof(float));
+    if (table->offsets == NULL) {
+        free(table);
+        return NULL;
+    }
+    /* nth_new_moons fills offsets a run at a time, as doubles first. */
+    double moons[256];
+    for (int i = 0; i <= table->count; i += 256) {
+        int run = table->count + 1 - i < 256 ? table->count + 1 - i : 256;
+        nth_new_moons(table->first + i, run, moons);
+        for (int j = 0; j < run; j++)
+            table->offsets[i + j] = (float)(moons[j] - mean_new_moon(table->first + i + j));
+    }
+    return table;
+}
+
+void lunation_table_destroy(struct LunationTable *table)
+{
+    if (table == NULL) return;
+    free(table->offsets);
+    free(table);
+}
+
+static bool in_table(const struct LunationTable *table, int n)
+{
+    return table && n >= table->first && n <= table->first + table->count;
+}
+
+double lunation_start(const struct LunationTable *table, int n)
+{
+    if (in_table(table, n))
+        return mean_new_moon(n) + table->offsets[n - table->first];
+    return nth_new_moon(n);
+}
+
+void lunation_from_moment(const struct LunationTable *table, double t,
+                          struct Lunation *lunation)
+{
+    int n = mean_lunation(t);
+    double start = lunation_start(table, n);
+    double end = lunation_start(table, n + 1);
+    while (start > t) {
+        end = start;
+        start = lunation_start(table, --n);
+    }
+    while (end <= t) {
+        start = end;
+        end = lunation_start(table, ++n + 1);
+    }
+
+    lunation->number = n;
+    lunation->meeus = n - MEEUS_OFFSET;
+    lunation->brown = n - BROWN_OFFSET;
+    lunation->start = start;
+    lunation->end = end;
+}
@@ -0,0 +1,45 @@
+#ifndef LUNATION_H
+#define LUNATION_H
+
+#include "calendar.h"
+
+/* Lunation numbers, and the new moons that bound each lunation.
+ *
+ * The same lunation goes by three numbers:
+ *   number: the n of nth_new_moon; 0 starts on January 11, AD 1
+ *   meeus:  Meeus's k; 0 starts on January 6, 2000
+ *   brown:  E. W. Brown's series; 1 starts on January 17, 1923
+ *
+ * A LunationTable holds the new moons for a range of moments, so that
+ * looking one up is a subtraction and an index. Outside its range, or
+ * with no table, lunation_from_moment computes them with nth_new_moon.
+ * The offsets are all filled in when the table is made and never
+ * refined later, so lookups from several threads need no locking. */
+
+struct Lunation {
+    int number;
+    int meeus;
+    int brown;
+    double start;       /* new moon at or before the moment */
+    double end;         /* the next new moon */
+};
+
+struct LunationTable {
+    int first;          /* number of the lunation starting at offsets[0] */
+    int count;          /* lunations covered; there are count + 1 offsets */
+    float *offsets;     /* each new moon less its mean new moon, in days */
+};
+
+/* Returns NULL if memory can't be allocated. */
+struct LunationTable *lunation_table_create(double from, double to);
+void lunation_table_destroy(struct LunationTable *table);
+
+/* table may be NULL. The offsets are kept as floats, so new moons from
+   the table are within a few milliseconds of nth_new_moon's. */
+void lunation_from_moment(const struct LunationTable *table, double t,
+                          struct Lunation *lunation);
+
+/* The new moon starting lunation number n. */
+double lunation_start(const struct LunationTable *table, int n);
+
+#endif
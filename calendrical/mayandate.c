@@ -1,8 +1,36 @@
-/* Output the date in the Mayan fashion. */
+/* Output the date in the Mayan fashion.
+   With -d, ask calendard rather than working it out. */
 
 #include <stdio.h>
+#include <string.h>
 #include <time.h>
 #include "calendar.h"
+#include "format.h"
+#include "calclient.h"
+
+/* Both requests go out before either answer is read. */
+static bool ask_daemon(int rd, int lc[5], int *h_month, int *h_day,
+                       int *t_number, int *t_name)
+{
+    struct CaldClient *client = cald_connect(NULL);
+    if (client == NULL) return false;
+    struct CaldRequest q[2] = {
+        { .op = CALD_MAYAN_LONG_COUNT, .args = { rd } },
+        { .op = CALD_MAYAN_CALENDAR_ROUND, .args = { rd } }
+    };
+    struct CaldResponse r[2];
+    bool ok = cald_send(client, q, 2) &&
+        cald_receive(client, &r[0]) && cald_receive(client, &r[1]) &&
+        r[0].status == CALD_OK && r[1].status == CALD_OK;
+    cald_close(client);
+    if (!ok) return false;
+    for (int i = 0; i < 5; i++) lc[i] = r[0].values[i];
+    *h_month = r[1].values[0];
+    *h_day = r[1].values[1];
+    *t_number = r[1].values[2];
+    *t_name = r[1].values[3];
+    return true;
+}
 
 int main(int argc, char *argv[])
 {
@@ -16,13 +44,26 @@ int main(int argc, char *argv[])
 
     int rd = fixed_from_struct_tm(today);
 
-    mayan_long_count_from_fixed(rd, &baktun, &katun, &tun, &uinal, &kin);
-    mayan_haab_from_fixed(rd, &h_month, &h_day);
-    mayan_tzolkin_from_fixed(rd, &t_number, &t_name);
+    int lc[5];
+    if (argc > 1 && strcmp(argv[1], "-d") == 0 &&
+        ask_daemon(rd, lc, &h_month, &h_day, &t_number, &t_name)) {
+        baktun = lc[0]; katun = lc[1]; tun = lc[2]; uinal = lc[3]; kin = lc[4];
+    } else {
+        mayan_long_count_from_fixed(rd, &baktun, &katun, &tun, &uinal, &kin);
+        mayan_haab_from_fixed(rd, &h_month, &h_day);
+        mayan_tzolkin_from_fixed(rd, &t_number, &t_name);
+    }
 
-    printf("Long Count = %d.%d.%d.%d.%d; Tzolkin = %d %s; Haab = %d %s\n",
-        baktun, katun, tun, uinal, kin,
-        t_number, TzolkinNames[t_name],
-        h_day, HaabMonths[h_month]);
+    char lc_text[FORMAT_MAX], tzolkin[FORMAT_MAX], haab[FORMAT_MAX];
+    format_mayan_long_count(lc_text, baktun, katun, tun, uinal, kin);
+    format_mayan_tzolkin(tzolkin, t_number, t_name);
+    format_mayan_haab(haab, h_month, h_day);
+    fputs("Long Count = ", stdout);
+    fputs(lc_text, stdout);
+    fputs("; Tzolkin = ", stdout);
+    fputs(tzolkin, stdout);
+    fputs("; Haab = ", stdout);
+    fputs(haab, stdout);
+    fputs("\n", stdout);
 
 }
@@ -0,0 +1,147 @@
+/*
+ *  memo.c
+ *  Lock-free tables of remembered astronomical results.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <limits.h>
+#include "memo.h"
+
+static const char *memo_names[MEMO_FUNCTIONS] = {
+    "chinese_winter_solstice_on_or_before",
+    "chinese_new_moon_on_or_after",
+    "chinese_new_moon_before",
+    "current_major_solar_term"
+};
+
+const char *calendrical_memo_name(enum MemoFunction f)
+{
+    if (f < 0 || f >= MEMO_FUNCTIONS) return NULL;
+    return memo_names[f];
+}
+
+#pragma mark Tables
+
+/* A slot holds the date in its high half and the result in its low half,
+   so it's read and written whole. No date is INT_MIN, which marks an
+   empty slot. */
+#define EMPTY ((uint64_t)(uint32_t)INT_MIN << 32)
+
+static uint64_t pack(int date, int result)
+{
+    return (uint64_t)(uint32_t)date << 32 | (uint32_t)result;
+}
+
+static int slot_date(uint64_t slot) { return (int)(uint32_t)(slot >> 32); }
+static int slot_result(uint64_t slot) { return (int)(uint32_t)slot; }
+
+static uint64_t *memo_slots;            /* MEMO_FUNCTIONS tables of memo_mask + 1 */
+static size_t memo_mask;
+
+#pragma mark Stats
+
+/* Threads count into stripes of their own, mostly, so hits in different
+   threads don't fight over one cache line. */
+#define STRIPES 16
+
+struct Stripe {
+    struct MemoCounter functions[MEMO_FUNCTIONS];
+} __attribute__((aligned(64)));
+
+static struct Stripe stripes[STRIPES];
+static unsigned next_stripe;
+static __thread int my_stripe = -1;
+
+static struct MemoCounter *counter(enum MemoFunction f)
+{
+    if (my_stripe < 0)
+        my_stripe = (int)(__atomic_fetch_add(&next_stripe, 1, __ATOMIC_RELAXED) % STRIPES);
+    return &stripes[my_stripe].functions[f];
+}
+
+static void count(unsigned long long *c)
+{
+    __atomic_fetch_add(c, 1, __ATOMIC_RELAXED);
+}
+
+void calendrical_memo_stats(struct MemoStats *stats)
+{
+    struct MemoStats s = { 0 };
+    s.entries = memo_slots ? memo_mask + 1 : 0;
+    for (int i = 0; i < STRIPES; i++)
+        for (int f = 0; f < MEMO_FUNCTIONS; f++) {
+            const struct MemoCounter *c = &stripes[i].functions[f];
+            s.functions[f].hits += __atomic_load_n(&c->hits, __ATOMIC_RELAXED);
+            s.functions[f].misses += __atomic_load_n(&c->misses, __ATOMIC_RELAXED);
+            s.functions[f].evictions += __atomic_load_n(&c->evictions, __ATOMIC_RELAXED);
+        }
+    if (stats) *stats = s;
+}
+
+void calendrical_memo_reset_stats(void)
+{
+    for (int i = 0; i < STRIPES; i++)
+        for (int f = 0; f < MEMO_FUNCTIONS; f++) {
+            struct MemoCounter *c = &stripes[i].functions[f];
+            __atomic_store_n(&c->hits, 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&c->misses, 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&c->evictions, 0, __ATOMIC_RELAXED);
+        }
+}
+
+#pragma mark Switching
+
+bool calendrical_memo_enable(size_t entries)
+{
+    calendrical_memo_disable();
+    if (entries == 0) return true;
+
+    size_t size = 1;
+    while (size < entries && size <= SIZE_MAX / 2 / MEMO_FUNCTIONS / sizeof(uint64_t))
+        size *= 2;
+    uint64_t *slots = malloc(size * MEMO_FUNCTIONS * sizeof(*slots));
+    if (slots == NULL) return false;
+    for (size_t i = 0; i < size * MEMO_FUNCTIONS; i++) slots[i] = EMPTY;
+
+    calendrical_memo_reset_stats();
+    memo_mask = size - 1;
+    __atomic_store_n(&memo_slots, slots, __ATOMIC_RELEASE);
+    return true;
+}
+
+void calendrical_memo_disable(void)
+{
+    uint64_t *slots = __atomic_exchange_n(&memo_slots, NULL, __ATOMIC_ACQ_REL);
+    free(slots);
+}
+
+#pragma mark Hooks
+
+static uint64_t *slot(uint64_t *slots, enum MemoFunction f, int date)
+{
+    return &slots[f * (memo_mask + 1) + ((size_t)(unsigned)date & memo_mask)];
+}
+
+bool memo_lookup(enum MemoFunction f, int date, int *result)
+{
+    uint64_t *slots = __atomic_load_n(&memo_slots, __ATOMIC_ACQUIRE);
+    if (slots == NULL || date == INT_MIN) return false;
+    uint64_t s = __atomic_load_n(slot(slots, f, date), __ATOMIC_RELAXED);
+    if (slot_date(s) == date) {
+        count(&counter(f)->hits);
+        *result = slot_result(s);
+        return true;
+    }
+    count(&counter(f)->misses);
+    return false;
+}
+
+void memo_store(enum MemoFunction f, int date, int result)
+{
+    uint64_t *slots = __atomic_load_n(&memo_slots, __ATOMIC_ACQUIRE);
+    if (slots == NULL || date == INT_MIN) return;
+    uint64_t old = __atomic_exchange_n(slot(slots, f, date), pack(date, result),
+                                       __ATOMIC_RELAXED);
+    if (old != EMPTY && slot_date(old) != date) count(&counter(f)->evictions);
+}
@@ -0,0 +1,57 @@
+#ifndef MEMO_H
+#define MEMO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Remembered results of the astronomical functions that many Chinese
+ * date calculations ask for over and over with the same argument.
+ *
+ * Off until calendrical_memo_enable is called. Each function then gets a
+ * table of the given number of entries, rounded up to a power of two,
+ * indexed by its date argument, so a run of that many consecutive dates
+ * never collides; a date that lands on a slot already taken replaces what
+ * was there (an eviction). Results are exactly what the functions return
+ * without it.
+ *
+ * Lookups and stores are single atomic loads and stores, so any number of
+ * threads can share the tables without locks. Enabling, resizing and
+ * disabling are not safe while other threads are calling into the
+ * library. */
+
+enum MemoFunction {
+    MEMO_WINTER_SOLSTICE,       /* chinese_winter_solstice_on_or_before */
+    MEMO_NEW_MOON_ON_OR_AFTER,  /* chinese_new_moon_on_or_after */
+    MEMO_NEW_MOON_BEFORE,       /* chinese_new_moon_before */
+    MEMO_MAJOR_SOLAR_TERM,      /* current_major_solar_term */
+    MEMO_FUNCTIONS
+};
+
+struct MemoCounter {
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long evictions;
+};
+
+struct MemoStats {
+    size_t entries;             /* per function; 0 when off */
+    struct MemoCounter functions[MEMO_FUNCTIONS];
+};
+
+const char *calendrical_memo_name(enum MemoFunction f);
+
+/* Turn memoization on with room for entries results per function, or
+   resize it, forgetting what it had. Returns false if memory can't be
+   allocated, leaving it off. 0 turns it off. */
+bool calendrical_memo_enable(size_t entries);
+void calendrical_memo_disable(void);
+
+/* Counts since it was enabled or the stats reset, over all threads. */
+void calendrical_memo_stats(struct MemoStats *stats);
+void calendrical_memo_reset_stats(void);
+
+/* Hooks used inside the library. */
+bool memo_lookup(enum MemoFunction f, int date, int *result);
+void memo_store(enum MemoFunction f, int date, int result);
+
+#endif
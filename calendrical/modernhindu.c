@@ -0,0 +1,408 @@
+/*
+ *  modernhindu.c
+ *  The modern Hindu solar and lunar calendars, and ranges of them.
+ *
+ *  Positions count revolutions from the creation, 1,955,880,000 sidereal
+ *  years before the epoch of the Kali Yuga. Counted from there the
+ *  fractions of a revolution are lost to rounding, so they are counted
+ *  from the epoch instead, with the fraction each motion had made by then
+ *  as a constant. The sun and moon had made whole revolutions.
+ */
+
+#include <stdlib.h>
+#include <math.h>
+#include "modernhindu.h"
+
+#define HINDU_EPOCH -1132959        /* February 18, 3102 BCE (Julian) */
+#define HINDU_SOLAR_ERA 3179
+#define HINDU_LUNAR_ERA 3044
+
+#define SIDEREAL_YEAR (365 + 279457.0 / 1080000)
+#define ANOMALISTIC_YEAR (1577917828000.0 / (4320000000 - 387))
+#define SIDEREAL_MONTH (27 + 4644439.0 / 14438334)
+#define SYNODIC_MONTH (29 + 7087771.0 / 13358334)
+#define ANOMALISTIC_MONTH (1577917828.0 / (57753336 - 488199))
+
+/* Revolutions at the epoch. */
+#define ANOMALISTIC_YEAR_AT_EPOCH 0.78575
+#define ANOMALISTIC_MONTH_AT_EPOCH 0.75
+
+#define UJJAIN_LATITUDE (23 + 9 / 60.0)
+
+static double mod(double x, double y)
+{
+    return x - y * floor(x / y);
+}
+
+static double mod3(double x, double a, double b)
+{
+    return a + mod(x - a, b - a);
+}
+
+static int amod(int x, int y)
+{
+    int r = x % y;
+    if (r < 0) r += y;
+    return r == 0 ? y : r;
+}
+
+#pragma mark Sines
+
+/* round(3438 sin(3.75 k degrees)), nudged by 0.215 as the Surya Siddhanta's
+   table is: the sines of Aryabhata. */
+static const int sine_table[25] = {
+    0, 225, 449, 671, 890, 1105, 1315, 1520, 1719, 1910, 2093, 2267, 2431,
+    2585, 2728, 2859, 2978, 3084, 3177, 3256, 3321, 3372, 3409, 3431, 3438
+};
+
+/* Entries past 24 go round the rest of the circle. */
+static double sine_entry(int k)
+{
+    int quadrant = (k / 24) & 3, i = k % 24;
+    double s;
+    if (quadrant == 0) s = sine_table[i];
+    else if (quadrant == 1) s = sine_table[24 - i];
+    else if (quadrant == 2) s = -sine_table[i];
+    else s = -sine_table[24 - i];
+    return s / 3438;
+}
+
+double hindu_sine(double theta)
+{
+    double entry = mod(theta, 360) / 3.75;
+    double fraction = entry - floor(entry);
+    int k = (int)floor(entry);
+    return fraction * sine_entry(k + 1) + (1 - fraction) * sine_entry(k);
+}
+
+double hindu_arcsin(double amp)
+{
+    if (amp < 0) return -hindu_arcsin(-amp);
+    int pos = 0;
+    while (pos < 24 && amp > sine_table[pos] / 3438.0) pos++;
+    if (pos == 0) return 0;
+    double below = sine_table[pos - 1] / 3438.0;
+    return 3.75 * (pos - 1 + (amp - below) / (sine_table[pos] / 3438.0 - below));
+}
+
+#pragma mark Positions
+
+static double mean_position(double t, double period, double at_epoch)
+{
+    return 360 * mod((t - HINDU_EPOCH) / period + at_epoch, 1);
+}
+
+static double true_position(double t, double period, double size,
+                            double anomalistic, double at_epoch, double change)
+{
+    double lambda = mean_position(t, period, 0);
+    double offset = hindu_sine(mean_position(t, anomalistic, at_epoch));
+    double contraction = fabs(offset) * change * size;
+    double equation = hindu_arcsin(offset * (size - contraction));
+    return mod(lambda - equation, 360);
+}
+
+double hindu_solar_longitude(double t)
+{
+    return true_position(t, SIDEREAL_YEAR, 14 / 360.0, ANOMALISTIC_YEAR,
+                         ANOMALISTIC_YEAR_AT_EPOCH, 1 / 42.0);
+}
+
+int hindu_zodiac(double t)
+{
+    return 1 + (int)floor(hindu_solar_longitude(t) / 30);
+}
+
+double hindu_lunar_longitude(double t)
+{
+    return true_position(t, SIDEREAL_MONTH, 32 / 360.0, ANOMALISTIC_MONTH,
+                         ANOMALISTIC_MONTH_AT_EPOCH, 1 / 96.0);
+}
+
+double hindu_lunar_phase(double t)
+{
+    return mod(hindu_lunar_longitude(t) - hindu_solar_longitude(t), 360);
+}
+
+int hindu_lunar_day_from_moment(double t)
+{
+    return 1 + (int)floor(hindu_lunar_phase(t) / 12);
+}
+
+static int lunar_day_from_phase(double phase)
+{
+    return 1 + (int)floor(phase / 12);
+}
+
+/* Bisects only until both ends are in the same sign, which is all the
+   calendar asks of it. */
+double hindu_new_moon_before(double t)
+{
+    double tau = t - hindu_lunar_phase(t) / 360 * SYNODIC_MONTH;
+    double l = tau - 1, u = fmin(t, tau + 1);
+    while (hindu_zodiac(l) != hindu_zodiac(u)) {
+        double x = (l + u) / 2;
+        if (x == l || x == u) break;
+        if (hindu_lunar_phase(x) < 180) u = x;
+        else l = x;
+    }
+    return (l + u) / 2;
+}
+
+static int hindu_calendar_year(double t)
+{
+    return (int)round((t - HINDU_EPOCH) / SIDEREAL_YEAR - hindu_solar_longitude(t) / 360);
+}
+
+#pragma mark Sunrise
+
+/* The sun's daily motion, given its anomaly and the sine of that. */
+static double hindu_daily_motion(double anomaly, double offset)
+{
+    double mean_motion = 360 / SIDEREAL_YEAR;
+    double epicycle = 14 / 360.0 - fabs(offset) / 1080;
+    int entry = (int)floor(anomaly / 3.75);
+    double sine_table_step = sine_entry(entry + 1) - sine_entry(entry);
+    double factor = -3438 / 225.0 * sine_table_step * epicycle;
+    return mean_motion * (factor + 1);
+}
+
+static double hindu_tropical_longitude(int date)
+{
+    double days = date - HINDU_EPOCH;
+    double precession = 27 - fabs(54 - mod(27 + 108 * 600 / 1577917828.0 * days, 108));
+    return mod(hindu_solar_longitude(date) - precession, 360);
+}
+
+static double hindu_rising_sign(double tropical)
+{
+    static const double sign_times[6] = { 1670 / 1800.0, 1795 / 1800.0, 1935 / 1800.0,
+                                          1935 / 1800.0, 1795 / 1800.0, 1670 / 1800.0 };
+    return sign_times[(int)floor(tropical / 30) % 6];
+}
+
+static double hindu_ascensional_difference(double tropical, double latitude)
+{
+    double sin_delta = 1397 / 3438.0 * hindu_sine(tropical);
+    double diurnal_radius = hindu_sine(90 + hindu_arcsin(sin_delta));
+    double tan_phi = hindu_sine(latitude) / hindu_sine(90 + latitude);
+    double earth_sine = sin_delta * tan_phi;
+    return hindu_arcsin(-earth_sine / diurnal_radius);
+}
+
+static double hindu_equation_of_time(double offset, double daily_motion)
+{
+    double equation_sun = offset * (57 + 18 / 60.0) * (14 / 360.0 - fabs(offset) / 1080);
+    return daily_motion / 360 * equation_sun / 360 * SIDEREAL_YEAR;
+}
+
+/* The book's equation of time, ascensional difference and solar sidereal
+   difference share the sun's anomaly, daily motion and tropical
+   longitude, so they're worked out once here. */
+double hindu_sunrise(int date)
+{
+    double anomaly = mean_position(date, ANOMALISTIC_YEAR, ANOMALISTIC_YEAR_AT_EPOCH);
+    double offset = hindu_sine(anomaly);
+    double daily_motion = hindu_daily_motion(anomaly, offset);
+    double tropical = hindu_tropical_longitude(date);
+    double solar_sidereal_difference = daily_motion * hindu_rising_sign(tropical);
+
+    return date + 0.25 - hindu_equation_of_time(offset, daily_motion) +
+        1577917828.0 / 1582237828 / 360 *
+        (hindu_ascensional_difference(tropical, UJJAIN_LATITUDE) +
+         solar_sidereal_difference / 4);
+}
+
+#pragma mark Solar
+
+void hindu_solar_from_fixed(int date, struct HinduSolarDate *sdate)
+{
+    double critical = hindu_sunrise(date + 1);
+    int month = hindu_zodiac(critical);
+    int begin = date - 3 - (int)mod(floor(hindu_solar_longitude(critical)), 30);
+    while (hindu_zodiac(hindu_sunrise(begin + 1)) != month) begin++;
+
+    sdate->year = hindu_calendar_year(critical) - HINDU_SOLAR_ERA;
+    sdate->month = month;
+    sdate->day = date - begin + 1;
+}
+
+int fixed_from_hindu_solar(struct HinduSolarDate sdate)
+{
+    int begin = (int)floor((sdate.year + HINDU_SOLAR_ERA + (sdate.month - 1) / 12.0) *
+                           SIDEREAL_YEAR + HINDU_EPOCH);
+    int d = begin - 3;
+    while (hindu_zodiac(hindu_sunrise(d + 1)) != sdate.month) d++;
+    return sdate.day - 1 + d;
+}
+
+#pragma mark Lunar
+
+/* The month and whether it's a leap month, from the new moon before. */
+static void lunar_month(double critical, int *rmonth, bool *rleap)
+{
+    double last_new_moon = hindu_new_moon_before(critical);
+    double next_new_moon = hindu_new_moon_before(floor(last_new_moon) + 35);
+    int solar_month = hindu_zodiac(last_new_moon);
+    *rleap = solar_month == hindu_zodiac(next_new_moon);
+    *rmonth = amod(solar_month + 1, 12);
+}
+
+static int lunar_year(int date, int month)
+{
+    return hindu_calendar_year(month <= 2 ? date + 180 : date) - HINDU_LUNAR_ERA;
+}
+
+void hindu_lunar_from_fixed(int date, struct HinduLunarDate *ldate)
+{
+    double critical = hindu_sunrise(date);
+    int day = hindu_lunar_day_from_moment(critical);
+
+    ldate->leap_day = day == hindu_lunar_day_from_moment(hindu_sunrise(date - 1));
+    lunar_month(critical, &ldate->month, &ldate->leap_month);
+    ldate->year = lunar_year(date, ldate->month);
+    ldate->day = day;
+}
+
+int fixed_from_hindu_lunar(struct HinduLunarDate ldate)
+{
+    double approx = HINDU_EPOCH +
+        SIDEREAL_YEAR * (ldate.year + HINDU_LUNAR_ERA + (ldate.month - 1) / 12.0);
+    int s = (int)floor(approx - SIDEREAL_YEAR *
+        mod3(hindu_solar_longitude(approx) / 360 - (ldate.month - 1) / 12.0, -0.5, 0.5));
+    int k = hindu_lunar_day_from_moment(s + 0.25);
+    /* k back to the new moon near s: the lunar day it starts, unless s
+       is near a new moon, when the month at s - 15 says which side. */
+    int back = k;
+    if (k <= 3 || k >= 27) {
+        struct HinduLunarDate mid;
+        hindu_lunar_from_fixed(s - 15, &mid);
+        if (mid.month != ldate.month || (mid.leap_month && !ldate.leap_month))
+            back = (int)mod3(k, -15, 15);
+        else
+            back = (int)mod3(k, 15, 45);
+    }
+    int est = s + ldate.day - back;
+    int tau = est - (int)mod3(hindu_lunar_day_from_moment(est + 0.25) - ldate.day, -15, 15);
+    int date = tau - 1;
+    for (;;) {
+        int d = hindu_lunar_day_from_moment(hindu_sunrise(date));
+        if (d == ldate.day || d == amod(ldate.day + 1, 30)) break;
+        date++;
+    }
+    return ldate.leap_day ? date + 1 : date;
+}
+
+#pragma mark Ranges
+
+struct HinduDays *hindu_days_create(int from, int to)
+{
+    if (to < from) return NULL;
+    struct HinduDays *days = calloc(1, sizeof *days);
+    if (!days) return NULL;
+    days->from = from;
+    days->to = to;
+    days->first = from - 1;
+    days->count = to - from + 3;
+    days->sunrise = malloc(days->count * sizeof *days->sunrise);
+    days->phase = malloc(days->count * sizeof *days->phase);
+    days->zodiac = malloc(days->count);
+    days->solar_day = malloc(days->count);
+    days->lunar_month = malloc(days->count);
+    days->leap_month = malloc(days->count * sizeof *days->leap_month);
+    if (!days->sunrise || !days->phase || !days->zodiac || !days->solar_day ||
+        !days->lunar_month || !days->leap_month) {
+        hindu_days_destroy(days);
+        return NULL;
+    }
+
+    for (int i = 0; i < days->count; i++) {
+        double t = hindu_sunrise(days->first + i);
+        double solar = hindu_solar_longitude(t);
+        days->sunrise[i] = t;
+        days->phase[i] = mod(hindu_lunar_longitude(t) - solar, 360);
+        days->zodiac[i] = (unsigned char)(1 + floor(solar / 30));
+    }
+
+    /* A solar month's days count from the change of sign at the sunrise
+       after; only the first month needs looking back for it. A lunar
+       month changes when the phase at sunrise goes back round past 0. */
+    struct HinduSolarDate sdate;
+    hindu_solar_from_fixed(from, &sdate);
+    for (int i = 1; i <= days->count - 2; i++) {
+        if (i == 1) days->solar_day[i] = (unsigned char)sdate.day;
+        else if (days->zodiac[i + 1] != days->zodiac[i]) days->solar_day[i] = 1;
+        else days->solar_day[i] = days->solar_day[i - 1] + 1;
+
+        if (i == 1 || days->phase[i] < days->phase[i - 1]) {
+            int month;
+            bool leap;
+            lunar_month(days->sunrise[i], &month, &leap);
+            days->lunar_month[i] = (unsigned char)month;
+            days->leap_month[i] = leap;
+        } else {
+            days->lunar_month[i] = days->lunar_month[i - 1];
+            days->leap_month[i] = days->leap_month[i - 1];
+        }
+    }
+    return days;
+}
+
+void hindu_days_destroy(struct HinduDays *days)
+{
+    if (!days) return;
+    free(days->sunrise);
+    free(days->phase);
+    free(days->zodiac);
+    free(days->solar_day);
+    free(days->lunar_month);
+    free(days->leap_month);
+    free(days);
+}
+
+void hindu_solar_from_fixed_with(const struct HinduDays *days, int date,
+                                 struct HinduSolarDate *sdate)
+{
+    if (!days || date < days->from || date > days->to) {
+        hindu_solar_from_fixed(date, sdate);
+        return;
+    }
+    int i = date - days->first;
+    sdate->year = hindu_calendar_year(days->sunrise[i + 1]) - HINDU_SOLAR_ERA;
+    sdate->month = days->zodiac[i + 1];
+    sdate->day = days->solar_day[i];
+}
+
+void hindu_lunar_from_fixed_with(const struct HinduDays *days, int date,
+                                 struct HinduLunarDate *ldate)
+{
+    if (!days || date < days->from || date > days->to) {
+        hindu_lunar_from_fixed(date, ldate);
+        return;
+    }
+    int i = date - days->first;
+    int day = lunar_day_from_phase(days->phase[i]);
+    ldate->month = days->lunar_month[i];
+    ldate->leap_month = days->leap_month[i];
+    ldate->year = lunar_year(date, ldate->month);
+    ldate->day = day;
+    ldate->leap_day = day == lunar_day_from_phase(days->phase[i - 1]);
+}
+
+void hindu_solar_from_fixed_n(int from, size_t count, struct HinduSolarDate *dates)
+{
+    if (count == 0) return;
+    struct HinduDays *days = hindu_days_create(from, from + (int)count - 1);
+    for (size_t i = 0; i < count; i++)
+        hindu_solar_from_fixed_with(days, from + (int)i, &dates[i]);
+    hindu_days_destroy(days);
+}
+
+void hindu_lunar_from_fixed_n(int from, size_t count, struct HinduLunarDate *dates)
+{
+    if (count == 0) return;
+    struct HinduDays *days = hindu_days_create(from, from + (int)count - 1);
+    for (size_t i = 0; i < count; i++)
+        hindu_lunar_from_fixed_with(days, from + (int)i, &dates[i]);
+    hindu_days_destroy(days);
+}
@@ -0,0 +1,90 @@
+#ifndef MODERNHINDU_H
+#define MODERNHINDU_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "calendar.h"
+
+/* The modern Hindu calendars, by the Surya Siddhanta: true positions of
+ * the sun and moon worked out with the Hindu sine table, and days that
+ * begin at sunrise in Ujjain. (hindu.c has the older mean ones.)
+ *
+ * A solar month begins with the first sunrise after the sun enters its
+ * sign, Mesha being month 1; years are of the Saka era.
+ *
+ * A lunar month runs from one new moon to the next and is named for the
+ * sign the sun is in at the new moon that starts it, Chaitra being month
+ * 1. When the next new moon is in the same sign, the month is a leap
+ * month, numbered as the month after it. A day is numbered by the lunar
+ * day (tithi) current at its sunrise, so a number can be skipped, or
+ * repeated, the second being a leap day. Years are of the Vikrama era.
+ *
+ * Each conversion costs a few sunrises, and a lunar date two searches for
+ * new moons as well. HinduDays keeps the sunrises of a range of days and
+ * what follows from them, each new moon search done once per month, so
+ * converting a date within it is a lookup; the _n functions convert a run
+ * of days that way. */
+
+struct HinduSolarDate {
+    int year;
+    int month;              /* 1 (Mesha) to 12 */
+    int day;
+};
+
+struct HinduLunarDate {
+    int year;
+    int month;              /* 1 (Chaitra) to 12 */
+    bool leap_month;
+    int day;                /* 1 to 30 */
+    bool leap_day;
+};
+
+/* Angles in degrees. The sine is interpolated in the table of 24 sines
+   to 90 degrees, as whole minutes of a radius of 3438 minutes. */
+double hindu_sine(double theta) __attribute__((const));
+double hindu_arcsin(double amp) __attribute__((const));
+
+double hindu_solar_longitude(double t) __attribute__((const));
+int hindu_zodiac(double t) __attribute__((const));
+double hindu_lunar_longitude(double t) __attribute__((const));
+double hindu_lunar_phase(double t) __attribute__((const));
+int hindu_lunar_day_from_moment(double t) __attribute__((const));
+double hindu_new_moon_before(double t) __attribute__((const));
+/* In local time at Ujjain. */
+double hindu_sunrise(int date) __attribute__((const));
+
+void hindu_solar_from_fixed(int date, struct HinduSolarDate *sdate);
+int fixed_from_hindu_solar(struct HinduSolarDate sdate) __attribute__((const));
+void hindu_lunar_from_fixed(int date, struct HinduLunarDate *ldate);
+int fixed_from_hindu_lunar(struct HinduLunarDate ldate) __attribute__((const));
+
+struct HinduDays {
+    int from;               /* the days from through to */
+    int to;
+    int first;              /* from - 1; the arrays are indexed by date - first */
+    int count;              /* to - from + 3: the arrays run from from - 1 to to + 1 */
+    double *sunrise;
+    double *phase;          /* hindu_lunar_phase at sunrise, which gives the tithi */
+    unsigned char *zodiac;  /* hindu_zodiac at sunrise */
+    unsigned char *solar_day;
+    unsigned char *lunar_month;
+    bool *leap_month;
+};
+
+/* Works out every day's sunrise, phase and month up front; the _with
+   functions then only look them up, so one HinduDays can serve several
+   threads. Returns NULL if memory can't be allocated. */
+struct HinduDays *hindu_days_create(int from, int to);
+void hindu_days_destroy(struct HinduDays *days);
+
+/* These fall back to the ordinary functions for dates outside the range. */
+void hindu_solar_from_fixed_with(const struct HinduDays *days, int date,
+                                 struct HinduSolarDate *sdate);
+void hindu_lunar_from_fixed_with(const struct HinduDays *days, int date,
+                                 struct HinduLunarDate *ldate);
+
+/* The count days from from. */
+void hindu_solar_from_fixed_n(int from, size_t count, struct HinduSolarDate *dates);
+void hindu_lunar_from_fixed_n(int from, size_t count, struct HinduLunarDate *dates);
+
+#endif
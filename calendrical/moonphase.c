@@ -6,11 +6,14 @@
  * because the original was.
  */
 
+#include <stddef.h>
 #include <math.h>
 #include <time.h>
 #include <stdbool.h>
 
 #include "moonphase.h"
+#include "calendar.h"
+#include "profile.h"
 
 #define epoch       2444238.5      /* 1980 January 0.0 */
 
@@ -82,6 +85,24 @@ double jtime(struct tm *t)
        (t->tm_sec + 60 * (t->tm_min + 60 * t->tm_hour)) / 86400.0;
 }
 
+/* Batch forms of jdate and jtime that start from Unix time (GMT)
+   rather than a struct tm. The day count is rounded down by hand
+   instead of with floor() so that the loop vectorizes. */
+void jdate_n(const time_t *restrict times, long *restrict jdates, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        double q = times[i] / 86400.0;
+        long days = (long)q;
+        jdates[i] = days - (q < days) + 2440588L;
+    }
+}
+
+void jtime_n(const time_t *restrict times, double *restrict jtimes, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        jtimes[i] = times[i] / 86400.0 + 2440587.5;
+}
+
 /* Convert Julian date to year, month, day, which are returned via
    integer pointers to integers. */
 void jyear(double td, int *yy, int *mm, int *dd)
@@ -118,6 +139,12 @@ double jdaytosecs(double jday)
     return (jday - 2440587.5) * 86400;
 }
 
+void jdaytosecs_n(const double *restrict jdays, double *restrict secs, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        secs[i] = (jdays[i] - 2440587.5) * 86400;
+}
+
 /* Convert Julian time to hour, minutes, and seconds. */
 void jhms(double j, int *h, int *m, int *s)
 {
@@ -159,6 +186,7 @@ static double meanphase(double sdate, double k)
    obtain the true, corrected phase time. */
 static double truephase(double k, double ph)
 {
+    PROFILE_FUNCTION(PROFILE_TRUEPHASE);
     double t, t2, t3, pt, m, mprime, f;
     bool apcor = false;
 
@@ -235,11 +263,13 @@ static double truephase(double k, double ph)
 /* Solve the equation of Kepler. */
 static double kepler(double m, double ecc)
 {
+    PROFILE_FUNCTION(PROFILE_KEPLER);
     double e, delta;
 #define EPSILON 1E-6
 
     e = m = torad(m);
     do {
+        PROFILE_ITERATION(PROFILE_KEPLER);
         delta = e - ecc * sin(e) - m;
         e -= delta / (1 - ecc * cos(e));
     } while (abs(delta) > EPSILON);
@@ -302,30 +332,72 @@ void phaselist(double sdate, int pcount, double ph[], int *startphase)
     } while (i < pcount);
 }
 
-/* Calculate phase of moon as a fraction:
+/* The Meeus versions work in moments (fixed dates and fractions) and
+   convert at the edges. */
+void phasehunt_with(enum PhaseEngine engine, double sdate, double phases[5])
+{
+    if (engine == PHASE_MOONTOOL) {
+        phasehunt(sdate, phases);
+        return;
+    }
+    double t = moment_from_jd(sdate);
+    double start = new_moon_before(t);
+    double end = new_moon_after(t);
+    if (end == t) {
+        start = t;
+        end = new_moon_after(t + 1);
+    }
+    phases[0] = start;
+    phases[1] = lunar_phase_at_or_after(90, start);
+    phases[2] = lunar_phase_at_or_after(180, start);
+    phases[3] = lunar_phase_at_or_after(270, start);
+    phases[4] = end;
+    for (int i = 0; i < 5; i++) phases[i] = jd_from_moment(phases[i]);
+}
 
-   The argument is the time for which the phase is requested,
-   expressed as a Julian date and fraction.  Returns the terminator
-   phase angle as a percentage of a full circle (i.e., 0 to 1),
-   and stores into pointer arguments the illuminated fraction of
-   the Moon's disc, the Moon's age in days and fraction, the
-   distance of the Moon from the centre of the Earth, and the
-   angular diameter subtended by the Moon as seen by an observer
-   at the centre of the Earth. */
-double phase(double pdate,
-             double *pphase,        /* Illuminated fraction */
-             double *mage,          /* Age of moon in days */
-             double *dist,          /* Distance in kilometres */
-             double *angdia,        /* Angular diameter in degrees */
-             double *sudist,        /* Distance to Sun */
-             double *suangdia)      /* Sun's angular diameter */
+void phaselist_with(enum PhaseEngine engine, double sdate, int pcount, double ph[],
+                    int *startphase)
 {
+    if (engine == PHASE_MOONTOOL) {
+        phaselist(sdate, pcount, ph, startphase);
+        return;
+    }
+    double t = moment_from_jd(sdate);
+    double new_moon = new_moon_before(t);
+    *startphase = -1;
+
+    int c = 0, i = 0;
+    while (i < pcount) {
+        if (c % 4 == 0 && c > 0) new_moon = new_moon_after(new_moon + 1);
+        double d = c % 4 == 0 ? new_moon : lunar_phase_at_or_after(90 * (c % 4), new_moon);
+
+        if (d >= t) {
+            if (*startphase == -1) *startphase = (c % 4);
+            ph[i] = jd_from_moment(d);
+            i++;
+        }
+        c++;
+    }
+}
 
-    double  Day, N, M, Ec, Lambdasun, ml, MM, MN, Ev, Ae, A3, MmP,
-        mEc, A4, lP, V, lPP, NP, y, x, Lambdamoon, BetaM,
-        MoonAge, MoonPhase,
-        MoonDist, MoonDFrac, MoonAng, MoonPar,
-        F, SunDist, SunAng;
+/* The Sun's and Moon's places at a Julian date, by moontool's theory:
+   what phase() reports and moon_position() too. */
+struct MoonTheory {
+    double Lambdasun;       /* Sun's geocentric ecliptic longitude */
+    double SunDist;         /* Distance to Sun in km */
+    double SunAng;          /* Sun's angular size in degrees */
+    double Lambdamoon;      /* Moon's ecliptic longitude */
+    double BetaM;           /* Moon's ecliptic latitude */
+    double MoonAge;         /* Age of the Moon in degrees */
+    double MoonDist;        /* Distance in kilometres */
+    double MoonAng;         /* Angular diameter in degrees */
+    double MoonPar;         /* Horizontal parallax in degrees */
+};
+
+static void moon_theory(double pdate, struct MoonTheory *m)
+{
+    double  Day, N, M, Ec, ml, MM, MN, Ev, Ae, A3, MmP,
+        mEc, A4, lP, V, lPP, NP, y, x, MoonDFrac, F;
 
         /* Calculation of the Sun's position */
 
@@ -335,12 +407,12 @@ double phase(double pdate,
     Ec = kepler(M, eccent);                 /* Solve equation of Kepler */
     Ec = sqrt((1 + eccent) / (1 - eccent)) * tan(Ec / 2);
     Ec = 2 * todeg(atan(Ec));               /* True anomaly */
-        Lambdasun = fixangle(Ec + elongp);  /* Sun's geocentric ecliptic
-                                               longitude */
+        m->Lambdasun = fixangle(Ec + elongp);  /* Sun's geocentric ecliptic
+                                                  longitude */
     /* Orbital distance factor */
     F = ((1 + eccent * cos(torad(Ec))) / (1 - eccent * eccent));
-    SunDist = sunsmax / F;                  /* Distance to Sun in km */
-    SunAng = F * sunangsiz;                 /* Sun's angular size in degrees */
+    m->SunDist = sunsmax / F;               /* Distance to Sun in km */
+    m->SunAng = F * sunangsiz;              /* Sun's angular size in degrees */
 
 
         /* Calculation of the Moon's position */
@@ -355,7 +427,7 @@ double phase(double pdate,
     MN = fixangle(mlnode - 0.0529539 * Day);
 
     /* Evection */
-    Ev = 1.2739 * sin(torad(2 * (ml - Lambdasun) - MM));
+    Ev = 1.2739 * sin(torad(2 * (ml - m->Lambdasun) - MM));
 
     /* Annual equation */
     Ae = 0.1858 * sin(torad(M));
@@ -376,7 +448,7 @@ double phase(double pdate,
     lP = ml + Ev + mEc - Ae + A4;
 
     /* Variation */
-    V = 0.6583 * sin(torad(2 * (lP - Lambdasun)));
+    V = 0.6583 * sin(torad(2 * (lP - m->Lambdasun)));
 
     /* True longitude */
     lPP = lP + V;
@@ -391,39 +463,83 @@ double phase(double pdate,
     x = cos(torad(lPP - NP));
 
     /* Ecliptic longitude */
-    Lambdamoon = todeg(atan2(y, x));
-    Lambdamoon += NP;
+    m->Lambdamoon = todeg(atan2(y, x));
+    m->Lambdamoon += NP;
 
     /* Ecliptic latitude */
-    BetaM = todeg(asin(sin(torad(lPP - NP)) * sin(torad(minc))));
-
-    /* Calculation of the phase of the Moon */
+    m->BetaM = todeg(asin(sin(torad(lPP - NP)) * sin(torad(minc))));
 
     /* Age of the Moon in degrees */
-    MoonAge = lPP - Lambdasun;
-
-    /* Phase of the Moon */
-    MoonPhase = (1 - cos(torad(MoonAge))) / 2;
+    m->MoonAge = lPP - m->Lambdasun;
 
     /* Calculate distance of moon from the centre of the Earth */
 
-    MoonDist = (msmax * (1 - mecc * mecc)) /
+    m->MoonDist = (msmax * (1 - mecc * mecc)) /
        (1 + mecc * cos(torad(MmP + mEc)));
 
     /* Calculate Moon's angular diameter */
 
-    MoonDFrac = MoonDist / msmax;
-    MoonAng = mangsiz / MoonDFrac;
+    MoonDFrac = m->MoonDist / msmax;
+    m->MoonAng = mangsiz / MoonDFrac;
 
     /* Calculate Moon's parallax */
 
-    MoonPar = mparallax / MoonDFrac;
+    m->MoonPar = mparallax / MoonDFrac;
+}
+
+/* Calculate phase of moon as a fraction:
+
+   The argument is the time for which the phase is requested,
+   expressed as a Julian date and fraction.  Returns the terminator
+   phase angle as a percentage of a full circle (i.e., 0 to 1),
+   and stores into pointer arguments the illuminated fraction of
+   the Moon's disc, the Moon's age in days and fraction, the
+   distance of the Moon from the centre of the Earth, and the
+   angular diameter subtended by the Moon as seen by an observer
+   at the centre of the Earth. */
+double phase(double pdate,
+             double *pphase,        /* Illuminated fraction */
+             double *mage,          /* Age of moon in days */
+             double *dist,          /* Distance in kilometres */
+             double *angdia,        /* Angular diameter in degrees */
+             double *sudist,        /* Distance to Sun */
+             double *suangdia)      /* Sun's angular diameter */
+{
+    struct MoonTheory m;
+
+    PROFILE_FUNCTION(PROFILE_PHASE);
+
+    moon_theory(pdate, &m);
+
+    if (pphase) *pphase = (1 - cos(torad(m.MoonAge))) / 2;
+    if (mage) *mage = synmonth * (fixangle(m.MoonAge) / 360.0);
+    if (dist) *dist = m.MoonDist;
+    if (angdia) *angdia = m.MoonAng;
+    if (sudist) *sudist = m.SunDist;
+    if (suangdia) *suangdia = m.SunAng;
+    return fixangle(m.MoonAge) / 360.0;
+}
 
-    if (pphase) *pphase = MoonPhase;
-    if (mage) *mage = synmonth * (fixangle(MoonAge) / 360.0);
-    if (dist) *dist = MoonDist;
-    if (angdia) *angdia = MoonAng;
-    if (sudist) *sudist = SunDist;
-    if (suangdia) *suangdia = SunAng;
-    return fixangle(MoonAge) / 360.0;
+void moon_position(double pdate, struct MoonPosition *pos)
+{
+    struct MoonTheory m;
+    moon_theory(pdate, &m);
+
+    /* As right_ascension and declination do, with the obliquity once */
+    double e = torad(obliquity(moment_from_jd(pdate)));
+    double b = torad(m.BetaM), l = torad(m.Lambdamoon);
+    double sin_e = sin(e), cos_e = cos(e), sin_l = sin(l);
+    pos->longitude = fixangle(m.Lambdamoon);
+    pos->latitude = m.BetaM;
+    pos->right_ascension = fixangle(todeg(atan2(sin_l * cos_e - tan(b) * sin_e, cos(l))));
+    pos->declination = todeg(asin(sin(b) * cos_e + cos(b) * sin_e * sin_l));
+    pos->distance = m.MoonDist;
+    pos->parallax = m.MoonPar;
+    pos->angular_diameter = m.MoonAng;
+}
+
+void moon_position_n(const double *restrict pdates, struct MoonPosition *restrict pos,
+                     size_t n)
+{
+    for (size_t i = 0; i < n; i++) moon_position(pdates[i], &pos[i]);
 }
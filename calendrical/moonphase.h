@@ -1,3 +1,4 @@
+#include <stddef.h>
 #include <time.h>
 
 /* convert struct tm to Julian date */
@@ -6,6 +7,10 @@ long jdate(struct tm *t);
 /* convert struct tm to Julian date/time */
 double jtime(struct tm *t);
 
+/* batch jdate and jtime, from Unix time (GMT) instead of struct tm */
+void jdate_n(const time_t *times, long *jdates, size_t n);
+void jtime_n(const time_t *times, double *jtimes, size_t n);
+
 /* convert Julian date to Y, M, D */
 void jyear(double td, int *yy, int *mm, int *dd);
 
@@ -14,6 +19,7 @@ void jhms(double j, int *h, int *m, int *s);
 
 /* convert Julian date to Unixtime */
 double jdaytosecs(double jday);
+void jdaytosecs_n(const double *jdays, double *secs, size_t n);
 
 /* Find time of moon phases surrounding the given date.
  * Five phases are found, starting and ending with the new moons. */
@@ -25,6 +31,14 @@ void phasehunt(double sdate, double phases[5]);
  * where 0 = new, 1 = first, 2 = full, 3 = last. */
 void phaselist(double sdate, int pcount, double ph[], int *startphase);
 
+/* The same, choosing the theory: moontool's corrected mean phases, as
+ * above, or the Meeus lunar theory of calendar.c, which is slower but
+ * agrees with nth_new_moon and lunar_phase to the second. */
+enum PhaseEngine { PHASE_MOONTOOL, PHASE_MEEUS };
+void phasehunt_with(enum PhaseEngine engine, double sdate, double phases[5]);
+void phaselist_with(enum PhaseEngine engine, double sdate, int pcount, double ph[],
+                    int *startphase);
+
 /* Calculate phase of moon as a fraction.
  * Returns the terminator phase angle as a percentage of a full circle (0 to 1),
  * Returned in pointers:
@@ -34,3 +48,20 @@ void phaselist(double sdate, int pcount, double ph[], int *startphase);
  * angular diameter subtended by the moon as seen from the center of the Earth. */
 double phase(double pdate, double *pphase, double *mage, double *dist,
              double *angdia, double *sudist, double *suangdia);
+
+/* The Moon's geocentric place at a Julian date, by the theory phase()
+ * uses, which is good to a few minutes of arc. Angles are in degrees;
+ * the equatorial coordinates are of the date. */
+struct MoonPosition {
+    double longitude;           /* ecliptic */
+    double latitude;
+    double right_ascension;
+    double declination;
+    double distance;            /* from the centre of the Earth, km */
+    double parallax;            /* horizontal */
+    double angular_diameter;
+};
+
+void moon_position(double pdate, struct MoonPosition *pos);
+void moon_position_n(const double *pdates, struct MoonPosition *pos, size_t n);
+
@@ -0,0 +1,240 @@
+/*
+ *  moonrise.c
+ *  The Moon in a locale's sky, and its rises and sets.
+ */
+
+#include <math.h>
+#include "moonrise.h"
+
+#define torad(d) ((d) * (M_PI / 180.0))
+#define todeg(d) ((d) * (180.0 / M_PI))
+
+#define STEP (1.0 / 24)         /* the altitude is sampled hourly */
+#define CHUNK 192               /* hours of geocentric positions kept at once */
+#define TOLERANCE (1.0 / 86400)
+
+#pragma mark Topocentric
+
+/* What the parallax and horizon corrections need of a locale (Meeus,
+   Astronomical Algorithms, chapter 11). It is cheap enough to work out
+   again for each chunk of samples. */
+struct Observer {
+    double longitude;
+    double sin_phi;
+    double cos_phi;
+    double rho_sin_phi;         /* geocentric position, in Earth radii */
+    double rho_cos_phi;
+    double horizon;             /* refraction plus the dip, in degrees */
+};
+
+static void observer_from_locale(struct Locale locale, struct Observer *o)
+{
+    double phi = torad(locale.latitude);
+    double u = atan(0.99664719 * tan(phi));
+    double h = locale.elevation / 6378140;
+    o->longitude = locale.longitude;
+    o->sin_phi = sin(phi);
+    o->cos_phi = cos(phi);
+    o->rho_sin_phi = 0.99664719 * sin(u) + h * o->sin_phi;
+    o->rho_cos_phi = cos(u) + h * o->cos_phi;
+
+    double R = 6.372e6;
+    double elevation = fmax(0, locale.elevation);
+    o->horizon = 34.0 / 60 + todeg(acos(R / (R + elevation))) +
+        19.0 / 3600 * sqrt(elevation);
+}
+
+/* theta is the sidereal time at Greenwich, in degrees (Meeus chapter 40). */
+static void topocentric(const struct MoonPosition *pos, double theta,
+                        const struct Observer *o, struct MoonTopocentric *topo)
+{
+    double H = torad(theta + o->longitude - pos->right_ascension);
+    double delta = torad(pos->declination);
+    double sin_pi = sin(torad(pos->parallax));
+    double cos_delta = cos(delta), cos_H = cos(H), sin_H = sin(H);
+
+    double denominator = cos_delta - o->rho_cos_phi * sin_pi * cos_H;
+    double dalpha = atan2(-o->rho_cos_phi * sin_pi * sin_H, denominator);
+    double delta1 = atan2((sin(delta) - o->rho_sin_phi * sin_pi) * cos(dalpha),
+                          denominator);
+    double H1 = H - dalpha;
+    double sin_delta1 = sin(delta1), cos_delta1 = cos(delta1);
+    double cos_H1 = cos(H1), sin_H1 = sin(H1);
+
+    topo->right_ascension = fmod(pos->right_ascension + todeg(dalpha) + 360, 360);
+    topo->declination = todeg(delta1);
+    topo->hour_angle = remainder(todeg(H1), 360);
+    topo->altitude = todeg(asin(o->sin_phi * sin_delta1 +
+                                o->cos_phi * cos_delta1 * cos_H1));
+    topo->azimuth = fmod(todeg(atan2(-cos_delta1 * sin_H1,
+                                     sin_delta1 * o->cos_phi -
+                                     cos_delta1 * o->sin_phi * cos_H1)) + 360, 360);
+}
+
+void moon_topocentric(const struct MoonPosition *pos, double pdate, struct Locale locale,
+                      struct MoonTopocentric *topo)
+{
+    struct Observer o;
+    observer_from_locale(locale, &o);
+    topocentric(pos, sidereal_from_moment(moment_from_jd(pdate)), &o, topo);
+}
+
+#pragma mark Rise and set
+
+/* The Moon's place at a time, with the sidereal time to go with it. */
+struct Sample {
+    struct MoonPosition pos;
+    double theta;
+};
+
+static void sample(double pdate, struct Sample *s)
+{
+    moon_position(pdate, &s->pos);
+    s->theta = sidereal_from_moment(moment_from_jd(pdate));
+}
+
+/* Positive when the upper limb is above the horizon. */
+static double above(const struct Sample *s, const struct Observer *o)
+{
+    struct MoonTopocentric topo;
+    topocentric(&s->pos, s->theta, o, &topo);
+    return topo.altitude + s->pos.angular_diameter / 2 + o->horizon;
+}
+
+static double above_at(double pdate, const struct Observer *o)
+{
+    struct Sample s;
+    sample(pdate, &s);
+    return above(&s, o);
+}
+
+double moon_horizon_distance(double pdate, struct Locale locale)
+{
+    struct Observer o;
+    observer_from_locale(locale, &o);
+    return above_at(pdate, &o);
+}
+
+/* The Illinois form of false position, on a bracket of a change of sign. */
+static double refine(double a, double fa, double b, double fb, const struct Observer *o)
+{
+    double c = b;
+    for (int i = 0; i < 60 && fabs(b - a) > TOLERANCE; i++) {
+        c = b - fb * (b - a) / (fb - fa);
+        double fc = above_at(c, o);
+        if (fc == 0) break;
+        if ((fc < 0) == (fb < 0)) fa /= 2;
+        else {
+            a = b;
+            fa = fb;
+        }
+        b = c;
+        fb = fc;
+    }
+    return c;
+}
+
+static void add(struct MoonEvent *events, size_t max, size_t *found,
+                double time, bool rise)
+{
+    if (*found == max) return;
+    events[*found].time = time;
+    events[*found].rise = rise;
+    ++*found;
+}
+
+/* Scan the new intervals, samples[1] to samples[n + 1], for locale o;
+   samples[0], the one before, is only there if before is true. A sign
+   change brackets an event. Where the altitude turns within a couple of
+   degrees of the horizon without changing sign between samples, the turn
+   is found on the parabola through the three samples around it and
+   looked at, in case the Moon just rises and sets (or sets and rises) in
+   between. */
+#define GRAZE 2.0
+
+static void scan(const struct Sample *samples, const double *times, int n, bool before,
+                 const struct Observer *o, struct MoonEvent *events, size_t max,
+                 size_t *found)
+{
+    double f0 = before ? above(&samples[0], o) : NAN;
+    double f1 = above(&samples[1], o);
+    for (int i = 2; i <= n + 1 && *found < max; i++) {
+        double f2 = above(&samples[i], o);
+        if ((f1 < 0) != (f2 < 0)) {
+            add(events, max, found, refine(times[i - 1], f1, times[i], f2, o), f2 >= 0);
+        } else if (!isnan(f0) && (f0 < 0) == (f1 < 0) && fabs(f1) < GRAZE &&
+                   (f1 - f0) * (f2 - f1) < 0) {
+            double t0 = times[i - 2], t1 = times[i - 1], t2 = times[i];
+            double d0 = (f1 - f0) / (t1 - t0), d1 = (f2 - f1) / (t2 - t1);
+            double turn = (t0 + t1) / 2 - d0 * (t2 - t0) / 2 / (d1 - d0);
+            double f = above_at(turn, o);
+            if ((f < 0) != (f1 < 0)) {
+                add(events, max, found, refine(t0, f0, turn, f, o), f >= 0);
+                add(events, max, found, refine(turn, f, t2, f2, o), f2 >= 0);
+            }
+        }
+        f0 = f1;
+        f1 = f2;
+    }
+}
+
+void moon_events_n(double from, double to, const struct Locale *locales, size_t count,
+                   struct MoonEvent *events, size_t max, size_t *found)
+{
+    struct Sample samples[CHUNK + 2];
+    double times[CHUNK + 2];
+
+    for (size_t k = 0; k < count; k++) found[k] = 0;
+    if (count == 0 || !(to > from)) return;
+
+    /* Each chunk starts with the last two samples of the one before. */
+    times[1] = from;
+    sample(from, &samples[1]);
+    long hours = (long)ceil((to - from) / STEP);
+    for (long done = 0; done < hours; ) {
+        int n = hours - done < CHUNK ? (int)(hours - done) : CHUNK;
+        for (int i = 2; i <= n + 1; i++) {
+            times[i] = fmin(from + (done + i - 1) * STEP, to);
+            sample(times[i], &samples[i]);
+        }
+        for (size_t k = 0; k < count; k++) {
+            struct Observer o;
+            observer_from_locale(locales[k], &o);
+            scan(samples, times, n, done > 0, &o, events + k * max, max, &found[k]);
+        }
+        done += n;
+        times[0] = times[n];
+        samples[0] = samples[n];
+        times[1] = times[n + 1];
+        samples[1] = samples[n + 1];
+    }
+}
+
+size_t moon_events(double from, double to, struct Locale locale,
+                   struct MoonEvent *events, size_t max)
+{
+    size_t found;
+    moon_events_n(from, to, &locale, 1, events, max, &found);
+    return found;
+}
+
+/* A lunar day is a little under 25 hours; three days allow for a rise or
+   set that comes late, but not for the weeks without one near the poles. */
+static double next_event(double pdate, struct Locale locale, bool rise)
+{
+    struct MoonEvent events[16];
+    size_t found = moon_events(pdate, pdate + 3, locale, events, 16);
+    for (size_t i = 0; i < found; i++)
+        if (events[i].rise == rise) return events[i].time;
+    return 0;
+}
+
+double moonrise(double pdate, struct Locale locale)
+{
+    return next_event(pdate, locale, true);
+}
+
+double moonset(double pdate, struct Locale locale)
+{
+    return next_event(pdate, locale, false);
+}
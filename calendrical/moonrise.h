@@ -0,0 +1,61 @@
+#ifndef MOONRISE_H
+#define MOONRISE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "calendar.h"
+#include "moonphase.h"
+
+/* Where the Moon is in the sky of a locale, and when it rises and sets.
+ *
+ * Times are Julian dates in universal time, as in moonphase.h. The
+ * topocentric coordinates are corrected for parallax, which moves the
+ * Moon up to a degree from where it is seen from the centre of the
+ * Earth.
+ *
+ * The Moon rises or sets when its upper limb is on the horizon, with 34
+ * minutes of refraction and the dip of the horizon from the locale's
+ * elevation. Rises and sets are found by the Moon's altitude an hour
+ * apart, changes of sign bracketing each event, then refined to a
+ * second. Where the altitude turns close to the horizon between samples,
+ * as it does near the poles, the turn is looked at too, so a rise and set
+ * within the hour aren't missed unless they are very close together.
+ *
+ * The geocentric position at each hour doesn't depend on the locale, so
+ * moon_events_n works it out once for all the locales it is given. */
+
+struct MoonTopocentric {
+    double right_ascension;     /* degrees */
+    double declination;
+    double hour_angle;          /* -180 to 180, west positive */
+    double altitude;            /* above the horizon, without refraction */
+    double azimuth;             /* east of north */
+};
+
+void moon_topocentric(const struct MoonPosition *pos, double pdate, struct Locale locale,
+                      struct MoonTopocentric *topo);
+
+/* Altitude of the upper limb minus its altitude at rising. */
+double moon_horizon_distance(double pdate, struct Locale locale);
+
+struct MoonEvent {
+    double time;
+    bool rise;                  /* else a set */
+};
+
+/* Up to max of the rises and sets from from to to, in order. Returns how
+   many were written. */
+size_t moon_events(double from, double to, struct Locale locale,
+                   struct MoonEvent *events, size_t max);
+
+/* The same for count locales: locale k's go in events[k * max] onwards,
+   and found[k] is how many. */
+void moon_events_n(double from, double to, const struct Locale *locales, size_t count,
+                   struct MoonEvent *events, size_t max, size_t *found);
+
+/* The first rise or set after pdate, or 0 if there is none within a few
+   days, as in polar summer or winter. */
+double moonrise(double pdate, struct Locale locale);
+double moonset(double pdate, struct Locale locale);
+
+#endif
@@ -0,0 +1,131 @@
+/*
+ *  nowruz.c
+ *  Persian new years, computed once and kept.
+ */
+
+#include <stdlib.h>
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "nowruz.h"
+
+#define EPOCH_PERSIAN 226896
+#define MEAN_TROPICAL_YEAR 365.242189
+
+/* Years as elapsed years, with no gap for the missing year 0. */
+static int elapsed_from_year(int year) { return year > 0 ? year - 1 : year; }
+static int year_from_elapsed(int elapsed) { return elapsed >= 0 ? elapsed + 1 : elapsed; }
+
+struct NowruzCache *nowruz_cache_create(void)
+{
+    struct NowruzCache *cache = malloc(sizeof(*cache));
+    if (cache == NULL) return NULL;
+    cache->new_years = (struct DateTable){ 0, 0, NULL };
+    return cache;
+}
+
+void nowruz_cache_destroy(struct NowruzCache *cache)
+{
+    if (cache == NULL) return;
+    date_table_free(&cache->new_years);
+    free(cache);
+}
+
+static int new_year(const struct NowruzCache *cache, int elapsed)
+{
+    int date = date_table_get(&cache->new_years, elapsed);
+    if (date == DATE_TABLE_UNKNOWN) date = persian_new_year(year_from_elapsed(elapsed));
+    return date;
+}
+
+/* Each thread fills its own block of the range, so none write to the
+   same slots or, but at the edges, the same cache lines. */
+struct precompute_job {
+    struct NowruzCache *cache;
+    int lo;
+    int hi;
+};
+
+static void *precompute_thread(void *arg)
+{
+    struct precompute_job *job = arg;
+    const struct DateTable *table = &job->cache->new_years;
+    int *new_years = table->dates - table->first;
+    for (int e = job->lo; e <= job->hi; e++)
+        if (new_years[e] == DATE_TABLE_UNKNOWN) new_years[e] = persian_new_year(year_from_elapsed(e));
+    return NULL;
+}
+
+bool nowruz_cache_precompute(struct NowruzCache *cache, int from_year, int to_year,
+                             int threads)
+{
+    /* A year either side, for the mean year estimate being a year off
+       and for the start of the following year. */
+    int lo = elapsed_from_year(from_year) - 1;
+    int hi = elapsed_from_year(to_year) + 1;
+    if (hi <= lo + 1) return true;
+    if (!date_table_reserve(&cache->new_years, lo, hi)) return false;
+
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+    int years = hi - lo + 1;
+    if (threads > years) threads = years;
+
+    struct precompute_job *jobs = malloc(threads * sizeof(*jobs));
+    pthread_t *ids = malloc(threads * sizeof(*ids));
+    bool *started = malloc(threads * sizeof(*started));
+
+    if (jobs == NULL || ids == NULL || started == NULL) {
+        /* No room for threads; do them all here. */
+        struct precompute_job job = { cache, lo, hi };
+        precompute_thread(&job);
+    } else {
+        for (int i = 0; i < threads; i++) {
+            jobs[i] = (struct precompute_job){ cache,
+                lo + (int)((long long)years * i / threads),
+                lo + (int)((long long)years * (i + 1) / threads) - 1 };
+            started[i] = i > 0 && pthread_create(&ids[i], NULL,
+                                                 precompute_thread, &jobs[i]) == 0;
+            if (!started[i] && i > 0) precompute_thread(&jobs[i]);
+        }
+        precompute_thread(&jobs[0]);
+        for (int i = 1; i < threads; i++)
+            if (started[i]) pthread_join(ids[i], NULL);
+    }
+    free(jobs);
+    free(ids);
+    free(started);
+    return true;
+}
+
+int nowruz_cache_new_year(const struct NowruzCache *cache, int year)
+{
+    return new_year(cache, elapsed_from_year(year));
+}
+
+void nowruz_cache_persian_from_fixed(const struct NowruzCache *cache, int date,
+                                     int *ryear, int *rmonth, int *rday)
+{
+    /* The mean year is never more than a day or so off. */
+    int e = (int)floor((date - EPOCH_PERSIAN) / MEAN_TROPICAL_YEAR);
+    while (new_year(cache, e) > date) e--;
+    while (new_year(cache, e + 1) <= date) e++;
+
+    int day_of_year = date - new_year(cache, e) + 1;
+    int month = day_of_year <= 186 ? (day_of_year + 30) / 31
+                                   : (day_of_year - 6 + 29) / 30;
+    int day = day_of_year - (month <= 7 ? 31 * (month - 1) : 30 * (month - 1) + 6);
+
+    if (ryear) *ryear = year_from_elapsed(e);
+    if (rmonth) *rmonth = month;
+    if (rday) *rday = day;
+}
+
+int nowruz_cache_fixed_from_persian(const struct NowruzCache *cache,
+                                    int year, int month, int day)
+{
+    int offset = month <= 7 ? 31 * (month - 1) : 30 * (month - 1) + 6;
+    return nowruz_cache_new_year(cache, year) + offset + day - 1;
+}
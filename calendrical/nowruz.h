@@ -0,0 +1,43 @@
+#ifndef NOWRUZ_H
+#define NOWRUZ_H
+
+#include <stdbool.h>
+#include "calendar.h"
+#include "datetable.h"
+
+/* Astronomical Persian calendar with each year's new year (Nowruz)
+ * computed once and kept. Finding a new year takes a solar longitude
+ * estimate and a few Tehran noons; after that every date in the year is
+ * an offset from it. The results are the same as persian_from_fixed's
+ * and fixed_from_persian's.
+ *
+ * The new years kept are those nowruz_cache_precompute has found; a year
+ * outside them is found again each time it's asked for. Conversions
+ * only read the cache, so it can be shared by threads once the
+ * precomputing is done. */
+
+struct NowruzCache {
+    /* Fixed date of 1 Farvardin of each year, by elapsed years: year 1
+       is 0, year -1 is -1. */
+    struct DateTable new_years;
+};
+
+/* Returns NULL if memory can't be allocated. */
+struct NowruzCache *nowruz_cache_create(void);
+void nowruz_cache_destroy(struct NowruzCache *cache);
+
+/* Compute the new years of Persian years from_year through to_year, and
+ * one either side, using the given number of threads (0 for one per
+ * processor). Returns false if memory can't be allocated. */
+bool nowruz_cache_precompute(struct NowruzCache *cache, int from_year, int to_year,
+                             int threads);
+
+/* Fixed date of 1 Farvardin of year. */
+int nowruz_cache_new_year(const struct NowruzCache *cache, int year);
+
+void nowruz_cache_persian_from_fixed(const struct NowruzCache *cache, int date,
+                                     int *ryear, int *rmonth, int *rday);
+int nowruz_cache_fixed_from_persian(const struct NowruzCache *cache,
+                                    int year, int month, int day);
+
+#endif
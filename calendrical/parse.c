@@ -0,0 +1,580 @@
+/*
+ *  parse.c
+ *  Dates from text in one pass, with names found through perfect hashes.
+ */
+
+#ifndef CALENDRICAL_INLINE
+#define CALENDRICAL_INLINE
+#endif
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "parse.h"
+#include "format.h"
+
+#pragma mark Names
+
+/* Each table's keys hash to distinct slots under a seed found by trying
+   seeds in turn, so a lookup is one hash and one comparison. */
+#define NAME_SLOTS 128
+#define NAME_KEYS 40
+#define NAME_SEEDS 1000000
+
+struct NameKey {
+    const char *key;
+    unsigned char length;
+    unsigned char value;        /* 0 for an empty slot */
+};
+
+struct NameTable {
+    uint32_t seed;
+    bool linear;                /* no seed worked; search the keys instead */
+    int keys;
+    struct NameKey key[NAME_KEYS];
+    struct NameKey slot[NAME_SLOTS];
+};
+
+static struct NameTable tables[PARSE_NAMES];
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+
+static unsigned name_hash(uint32_t seed, const char *s, size_t length)
+{
+    uint32_t h = seed ^ (uint32_t)length * 0x9e3779b1u;
+    for (size_t i = 0; i < length; i++) h = (h ^ (unsigned char)s[i]) * 0x01000193u;
+    return (h ^ h >> 16) & (NAME_SLOTS - 1);
+}
+
+static void add_key(struct NameTable *t, const char *key, int value)
+{
+    if (key && t->keys < NAME_KEYS && strlen(key) < 256)
+        t->key[t->keys++] = (struct NameKey){ key, (unsigned char)strlen(key),
+                                              (unsigned char)value };
+}
+
+static void build_table(struct NameTable *t)
+{
+    for (uint32_t seed = 1; seed <= NAME_SEEDS; seed++) {
+        memset(t->slot, 0, sizeof(t->slot));
+        int k;
+        for (k = 0; k < t->keys; k++) {
+            struct NameKey *slot = &t->slot[name_hash(seed, t->key[k].key, t->key[k].length)];
+            if (slot->value) break;
+            *slot = t->key[k];
+        }
+        if (k == t->keys) {
+            t->seed = seed;
+            return;
+        }
+    }
+    t->linear = true;
+}
+
+static void build_tables(void)
+{
+    for (int i = 1; i <= 19; i++) add_key(&tables[PARSE_HAAB_MONTHS], HaabMonths[i], i);
+    for (int i = 1; i <= 20; i++) add_key(&tables[PARSE_TZOLKIN_NAMES], TzolkinNames[i], i);
+    for (int i = 1; i <= 10; i++) {
+        add_key(&tables[PARSE_STEMS], Stems[i].chinese, i);
+        add_key(&tables[PARSE_STEMS], Stems[i].pinyin, i);
+    }
+    for (int i = 1; i <= 12; i++) {
+        add_key(&tables[PARSE_BRANCHES], Branches[i].chinese, i);
+        add_key(&tables[PARSE_BRANCHES], Branches[i].zodiac, i);
+    }
+    for (int i = 1; i <= 13; i++) add_key(&tables[PARSE_HEBREW_MONTHS], HebrewMonths[i], i);
+    add_key(&tables[PARSE_HEBREW_MONTHS], "Adar I", 12);
+    for (int i = 1; i <= 12; i++) add_key(&tables[PARSE_ISLAMIC_MONTHS], IslamicMonths[i], i);
+    for (int i = 1; i <= 12; i++) {
+        add_key(&tables[PARSE_MAJOR_SOLAR_TERMS], MajorSolarTerms[i].chinese, i);
+        add_key(&tables[PARSE_MAJOR_SOLAR_TERMS], MajorSolarTerms[i].english, i);
+        add_key(&tables[PARSE_MINOR_SOLAR_TERMS], MinorSolarTerms[i].chinese, i);
+        add_key(&tables[PARSE_MINOR_SOLAR_TERMS], MinorSolarTerms[i].english, i);
+    }
+    for (int i = 0; i < PARSE_NAMES; i++) build_table(&tables[i]);
+}
+
+static bool same(const struct NameKey *k, const char *name, size_t length)
+{
+    return k->value && k->length == length && memcmp(k->key, name, length) == 0;
+}
+
+int parse_name(enum ParseNames table, const char *name, size_t length)
+{
+    if (table < 0 || table >= PARSE_NAMES) return 0;
+    pthread_once(&tables_once, build_tables);
+    const struct NameTable *t = &tables[table];
+    if (t->linear) {
+        for (int k = 0; k < t->keys; k++)
+            if (same(&t->key[k], name, length)) return t->key[k].value;
+        return 0;
+    }
+    const struct NameKey *slot = &t->slot[name_hash(t->seed, name, length)];
+    return same(slot, name, length) ? slot->value : 0;
+}
+
+#pragma mark Pieces
+
+/* Each of these reads from p, not past end, and returns where it stopped,
+   or NULL if the text isn't what's wanted. */
+
+static bool digit(char c)
+{
+    return (unsigned)(c - '0') < 10;
+}
+
+/* An optionally signed integer of up to nine digits. */
+static const char *read_int(const char *p, const char *end, int *v)
+{
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+    const char *first = p;
+    int n = 0;
+    while (p < end && digit(*p) && p - first < 9) n = n * 10 + (*p++ - '0');
+    if (p == first || (p < end && digit(*p))) return NULL;
+    *v = negative ? -n : n;
+    return p;
+}
+
+/* Years beyond these, and baktuns beyond BAKTUN_LIMIT, would overflow
+   the int fixed dates of the conversions. */
+#define YEAR_LIMIT 5000000
+#define BAKTUN_LIMIT 14000
+
+static const char *read_year(const char *p, const char *end, int *v)
+{
+    p = read_int(p, end, v);
+    return p && *v >= -YEAR_LIMIT && *v <= YEAR_LIMIT ? p : NULL;
+}
+
+/* One or two digits. */
+static const char *read_small(const char *p, const char *end, int *v)
+{
+    if (p >= end || !digit(*p)) return NULL;
+    int n = *p++ - '0';
+    if (p < end && digit(*p)) n = n * 10 + (*p++ - '0');
+    if (p < end && digit(*p)) return NULL;
+    *v = n;
+    return p;
+}
+
+static const char *expect(const char *p, const char *end, const char *s)
+{
+    size_t n = strlen(s);
+    if (!p || (size_t)(end - p) < n || memcmp(p, s, n) != 0) return NULL;
+    return p + n;
+}
+
+/* A name that may have spaces in it, ending at the space before a number. */
+static const char *read_spaced_name(const char *p, const char *end,
+                                    enum ParseNames table, int *v)
+{
+    const char *q = p;
+    while (q < end && q - p < 16 &&
+           !(*q == ' ' && q + 1 < end && (digit(q[1]) || q[1] == '-' || q[1] == '+')))
+        q++;
+    if (q == end || *q != ' ') return NULL;
+    *v = parse_name(table, p, q - p);
+    return *v ? q : NULL;
+}
+
+/* A name of letters. */
+static const char *read_word(const char *p, const char *end,
+                             enum ParseNames table, int *v)
+{
+    const char *q = p;
+    while (q < end && ((*q | 0x20) >= 'a' && (*q | 0x20) <= 'z')) q++;
+    *v = parse_name(table, p, q - p);
+    return *v ? q : NULL;
+}
+
+/* 一 to 十 as 1 to 10, or 0. */
+static int numeral(const char *p, const char *end)
+{
+    if (end - p < 3) return 0;
+    for (int i = 1; i <= 10; i++)
+        if (memcmp(p, ChineseNumerals[i], 3) == 0) return i;
+    return 0;
+}
+
+/* 1 to 99 in Chinese numerals: 五, 十五, 二十五, 廿五 or 卅. */
+static const char *read_chinese_number(const char *p, const char *end, int *v)
+{
+    int n, d;
+    const char *q;
+    if ((q = expect(p, end, "廿")) || (q = expect(p, end, "卅"))) {
+        n = memcmp(p, "廿", 3) == 0 ? 20 : 30;
+        p = q;
+    } else {
+        n = numeral(p, end);
+        if (n == 0) return NULL;
+        p += 3;
+        if (n < 10 && numeral(p, end) == 10) {
+            n *= 10;
+            p += 3;
+        }
+        if (n % 10 != 0) {
+            *v = n;
+            return p;
+        }
+    }
+    d = numeral(p, end);
+    if (d >= 1 && d <= 9) {
+        n += d;
+        p += 3;
+    }
+    *v = n;
+    return p;
+}
+
+#pragma mark Calendars
+
+/* Every parser also takes a state, which the _n functions keep from one
+   date to the next. */
+typedef size_t (*ParseOne)(const char *text, size_t length, int *rdate, void *state);
+
+/* Dates in a run mostly share their year, so the _n function keeps the
+   last one's start instead of working each date out in full. */
+struct GregorianState {
+    bool valid;
+    bool leap;
+    int year;
+    int new_year;
+};
+
+static const short days_before_month[2][13] = {
+    { 0, 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334 },
+    { 0, 0, 31, 60, 91, 121, 152, 182, 213, 244, 274, 305, 335 }
+};
+
+/* True if the 8 bytes at text are "dddd-dd-", with the digits' values in
+   *x from the lowest byte up. */
+static bool year_and_month(const char *text, uint64_t *x)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    uint64_t v;
+    memcpy(&v, text, 8);
+    v ^= 0x2d30302d30303030u;       /* "0000-00-" */
+    *x = v;
+    return (((v + 0x7676767676767676u) | v) & 0x8080808080808080u) == 0 &&
+        (v & 0xff0000ff00000000u) == 0;
+#else
+    for (int i = 0; i < 8; i++)
+        if (i == 4 || i == 7 ? text[i] != '-' : !digit(text[i])) return false;
+    *x = 0;
+    for (int i = 7; i >= 0; i--) *x = *x << 8 | (uint8_t)(text[i] - (i == 4 || i == 7 ? '-' : '0'));
+    return true;
+#endif
+}
+
+static size_t gregorian_one(const char *text, size_t length, int *rdate, void *state)
+{
+    const char *p = text, *end = text + length;
+    struct GregorianState *s = state;
+    int year, month, day;
+    uint64_t x;
+
+    /* The usual four-digit year, checked eight bytes at once. */
+    if (length >= 10 && year_and_month(text, &x) &&
+        digit(text[8]) && digit(text[9]) && (length == 10 || !digit(text[10]))) {
+        year = (int)(x & 0xff) * 1000 + (int)(x >> 8 & 0xff) * 100 +
+               (int)(x >> 16 & 0xff) * 10 + (int)(x >> 24 & 0xff);
+        month = (int)(x >> 40 & 0xff) * 10 + (int)(x >> 48 & 0xff);
+        day = (text[8] - '0') * 10 + (text[9] - '0');
+        p = text + 10;
+    } else {
+        p = read_year(p, end, &year);
+        p = expect(p, end, "-");
+        if (p) p = read_small(p, end, &month);
+        p = expect(p, end, "-");
+        if (p) p = read_small(p, end, &day);
+        if (!p) return 0;
+    }
+    if (month < 1 || month > 12 || day < 1) return 0;
+
+    if (s == NULL) {
+        if (day > last_day_of_gregorian_month(month, year)) return 0;
+        *rdate = fixed_from_gregorian(year, month, day);
+        return p - text;
+    }
+    if (!s->valid || s->year != year) {
+        s->valid = true;
+        s->year = year;
+        s->leap = gregorian_leap_year(year);
+        s->new_year = fixed_from_gregorian(year, 1, 1);
+    }
+    const short *before = days_before_month[s->leap];
+    int last = month == 12 ? 31 : before[month + 1] - before[month];
+    if (day > last) return 0;
+    *rdate = s->new_year + before[month] + day - 1;
+    return p - text;
+}
+
+static size_t iso_one(const char *text, size_t length, int *rdate, void *state)
+{
+    const char *p = text, *end = text + length;
+    int year, week, day;
+    (void)state;
+
+    p = read_year(p, end, &year);
+    p = expect(p, end, "-W");
+    if (p) p = read_small(p, end, &week);
+    p = expect(p, end, "-");
+    if (!p || p == end || !digit(*p)) return 0;
+    day = *p++ - '0';
+    if (p < end && digit(*p)) return 0;
+
+    int weeks = fixed_from_iso(year + 1, 1, 1) - fixed_from_iso(year, 1, 1) == 371 ? 53 : 52;
+    if (week < 1 || week > weeks || day < 1 || day > 7) return 0;
+    *rdate = fixed_from_iso(year, week, day);
+    return p - text;
+}
+
+/* Dates in the same year share its month starts. */
+struct HebrewState {
+    bool valid;
+    struct HebrewYearInfo info;
+};
+
+static size_t hebrew_one(const char *text, size_t length, int *rdate, void *state)
+{
+    const char *p = text, *end = text + length;
+    int day, month, year;
+    struct HebrewState *s = state;
+
+    p = read_small(p, end, &day);
+    p = expect(p, end, " ");
+    const char *name = p;
+    if (p) p = read_spaced_name(p, end, PARSE_HEBREW_MONTHS, &month);
+    bool adar_i = p && p - name == 6 && memcmp(name, "Adar I", 6) == 0;
+    p = expect(p, end, " ");
+    if (p) p = read_year(p, end, &year);
+    if (!p) return 0;
+
+    if (!s->valid || s->info.year != year) {
+        hebrew_year_info(year, &s->info);
+        s->valid = true;
+    }
+    int months = s->info.months;
+    if ((month == 13 || adar_i) && months == 12) return 0;
+    int i = month >= 7 ? month - 7 : month + months - 7;
+    if (day < 1 || day > s->info.month_start[i + 1] - s->info.month_start[i]) return 0;
+    *rdate = s->info.month_start[i] + day - 1;
+    return p - text;
+}
+
+static size_t islamic_one(const char *text, size_t length, int *rdate, void *state)
+{
+    const char *p = text, *end = text + length;
+    int day, month, year;
+    (void)state;
+
+    p = read_small(p, end, &day);
+    p = expect(p, end, " ");
+    if (p) p = read_spaced_name(p, end, PARSE_ISLAMIC_MONTHS, &month);
+    p = expect(p, end, " ");
+    if (p) p = read_year(p, end, &year);
+    if (!p) return 0;
+
+    if (day < 1 || day > last_day_of_islamic_month(month, year)) return 0;
+    *rdate = fixed_from_islamic(year, month, day);
+    return p - text;
+}
+
+static size_t mayan_one(const char *text, size_t length, int *rdate, void *state)
+{
+    const char *p = text, *end = text + length;
+    int baktun, katun, tun, uinal, kin;
+    (void)state;
+
+    p = read_int(p, end, &baktun);
+    p = expect(p, end, ".");
+    if (p) p = read_small(p, end, &katun);
+    p = expect(p, end, ".");
+    if (p) p = read_small(p, end, &tun);
+    p = expect(p, end, ".");
+    if (p) p = read_small(p, end, &uinal);
+    p = expect(p, end, ".");
+    if (p) p = read_small(p, end, &kin);
+    if (!p || baktun < -BAKTUN_LIMIT || baktun > BAKTUN_LIMIT ||
+        katun > 19 || tun > 19 || uinal > 17 || kin > 19) return 0;
+    int date = fixed_from_mayan_long_count(baktun, katun, tun, uinal, kin);
+
+    /* The calendar round, if there, must be the long count's. */
+    if (end - p > 1 && p[0] == ' ' && digit(p[1])) {
+        int number, name, day, month, n, m;
+        p = read_small(p + 1, end, &number);
+        p = expect(p, end, " ");
+        if (p) p = read_word(p, end, PARSE_TZOLKIN_NAMES, &name);
+        p = expect(p, end, " ");
+        if (p) p = read_small(p, end, &day);
+        p = expect(p, end, " ");
+        if (p) p = read_word(p, end, PARSE_HAAB_MONTHS, &month);
+        if (!p) return 0;
+        mayan_tzolkin_from_fixed(date, &n, &m);
+        if (n != number || m != name) return 0;
+        mayan_haab_from_fixed(date, &m, &n);
+        if (m != month || n != day) return 0;
+    }
+    *rdate = date;
+    return p - text;
+}
+
+/* The Chinese year in progress at the middle of Gregorian year g is the
+   (g + 2637)th since the epoch. */
+#define CHINESE_YEAR_OFFSET 2637
+
+struct ChineseState {
+    int near;
+    bool valid;
+    struct ChineseYearInfo info;
+};
+
+static const char *skip_spaces(const char *p, const char *end)
+{
+    while (p && p < end && *p == ' ') p++;
+    return p;
+}
+
+static size_t chinese_one(const char *text, size_t length, int *rdate, void *state)
+{
+    const char *p = text, *end = text + length;
+    struct ChineseState *s = state;
+    int stem, branch, month = 0, day = 0;
+    bool leap = false;
+    const char *q;
+
+    if (length < 6) return 0;
+    stem = parse_name(PARSE_STEMS, p, 3);
+    branch = parse_name(PARSE_BRANCHES, p + 3, 3);
+    if (!stem || !branch || stem % 2 != branch % 2) return 0;
+    p = skip_spaces(expect(p + 6, end, "年"), end);
+    if (p && (q = expect(p, end, "閏"))) {
+        leap = true;
+        p = q;
+    }
+    if (p && (q = expect(p, end, "正"))) {
+        month = 1;
+        p = q;
+    }
+    else if (p) p = read_chinese_number(p, end, &month);
+    p = skip_spaces(expect(p, end, "月"), end);
+    if (p && (q = expect(p, end, "初"))) p = q;
+    if (p) p = read_chinese_number(p, end, &day);
+    if (!p || month < 1 || month > 12 || day < 1 || day > 30) return 0;
+
+    /* The year of the cycle with this name, then the nearest such year. */
+    int year = stem;
+    while (calendrical_mod(year - 1, 12) + 1 != branch) year += 10;
+    int elapsed = gregorian_year_from_fixed(s->near) + CHINESE_YEAR_OFFSET;
+    elapsed += calendrical_mod(year - elapsed + 30, 60) - 30;
+    if (!s->valid || (s->info.cycle - 1) * 60 + s->info.year != elapsed) {
+        chinese_year_info(fixed_from_gregorian(elapsed - CHINESE_YEAR_OFFSET, 7, 1), &s->info);
+        s->valid = true;
+    }
+
+    const struct ChineseYearInfo *info = &s->info;
+    int i;
+    if (leap) i = month == info->leap_month ? month : -1;
+    else if (info->leap_month < 0 || month <= info->leap_month) i = month - 1;
+    else i = month;
+    if (i < 0 || i >= info->months ||
+        day > info->month_start[i + 1] - info->month_start[i]) return 0;
+    *rdate = info->month_start[i] + day - 1;
+    return p - text;
+}
+
+#pragma mark Dates
+
+size_t parse_gregorian(const char *text, size_t length, int *rdate)
+{
+    return gregorian_one(text, length, rdate, NULL);
+}
+
+size_t parse_iso(const char *text, size_t length, int *rdate)
+{
+    return iso_one(text, length, rdate, NULL);
+}
+
+size_t parse_hebrew(const char *text, size_t length, int *rdate)
+{
+    struct HebrewState state = { false };
+    return hebrew_one(text, length, rdate, &state);
+}
+
+size_t parse_islamic(const char *text, size_t length, int *rdate)
+{
+    return islamic_one(text, length, rdate, NULL);
+}
+
+size_t parse_mayan(const char *text, size_t length, int *rdate)
+{
+    return mayan_one(text, length, rdate, NULL);
+}
+
+size_t parse_chinese(const char *text, size_t length, int near, int *rdate)
+{
+    struct ChineseState state = { .near = near };
+    return chinese_one(text, length, rdate, &state);
+}
+
+#pragma mark Batches
+
+/* Inlined into each caller, so the call through one becomes a direct
+   call the compiler can inline too. */
+static inline size_t parse_each(const char *text, size_t length, char separator,
+                                int *dates, size_t max, size_t *consumed,
+                                ParseOne one, void *state)
+{
+    size_t used = 0, n = 0;
+    while (n < max && used < length) {
+        size_t k = one(text + used, length - used, &dates[n], state);
+        if (k == 0) break;
+        if (used + k < length) {
+            if (text[used + k] != separator) break;
+            k++;
+        }
+        used += k;
+        n++;
+    }
+    if (consumed) *consumed = used;
+    return n;
+}
+
+size_t parse_gregorian_n(const char *text, size_t length, char separator,
+                         int *dates, size_t max, size_t *consumed)
+{
+    struct GregorianState state = { false };
+    return parse_each(text, length, separator, dates, max, consumed, gregorian_one, &state);
+}
+
+size_t parse_iso_n(const char *text, size_t length, char separator,
+                   int *dates, size_t max, size_t *consumed)
+{
+    return parse_each(text, length, separator, dates, max, consumed, iso_one, NULL);
+}
+
+size_t parse_hebrew_n(const char *text, size_t length, char separator,
+                      int *dates, size_t max, size_t *consumed)
+{
+    struct HebrewState state = { false };
+    return parse_each(text, length, separator, dates, max, consumed, hebrew_one, &state);
+}
+
+size_t parse_islamic_n(const char *text, size_t length, char separator,
+                       int *dates, size_t max, size_t *consumed)
+{
+    return parse_each(text, length, separator, dates, max, consumed, islamic_one, NULL);
+}
+
+size_t parse_mayan_n(const char *text, size_t length, char separator,
+                     int *dates, size_t max, size_t *consumed)
+{
+    return parse_each(text, length, separator, dates, max, consumed, mayan_one, NULL);
+}
+
+size_t parse_chinese_n(const char *text, size_t length, char separator, int near,
+                       int *dates, size_t max, size_t *consumed)
+{
+    struct ChineseState state = { .near = near };
+    return parse_each(text, length, separator, dates, max, consumed, chinese_one, &state);
+}
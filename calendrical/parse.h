@@ -0,0 +1,72 @@
+#ifndef PARSE_H
+#define PARSE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "calendar.h"
+
+/* Dates from text, in the forms format.h writes, without allocation.
+ *
+ * Each parser reads one date from the start of text, looking at no more
+ * than length bytes, and returns the number of bytes it took, or 0 if
+ * they aren't a valid date: a month or day out of range, a leap month in
+ * a year without one, or a Mayan calendar round that doesn't go with its
+ * long count, or a year too far off for an int fixed date (beyond
+ * 5,000,000 either way). The fixed date is written only when one is
+ * returned.
+ *
+ *   Gregorian   2024-03-09, -0044-03-15, +12345-01-01
+ *   ISO         2026-W42-5
+ *   Hebrew      29 Adar I 5784; Adar alone is month 12, and Adar I
+ *               only goes with a leap year
+ *   Islamic     28 Sha'ban 1445
+ *   Mayan       13.0.0.0.0, or 13.0.0.0.0 4 Ahau 8 Cumku
+ *   Chinese     甲辰年閏四月初五 or 甲子年 閏四月 十五; the cycle isn't
+ *               written, so the year is the one of that name nearest near
+ *
+ * The _n functions read dates one after another, each followed by
+ * separator or the end of text, into dates. They stop at the end of
+ * text, after max dates, or at the first that doesn't parse, and return
+ * how many they read; if consumed isn't NULL, *consumed is how many bytes
+ * those took, so text + *consumed is where they stopped. The separator
+ * shouldn't be a character that can appear in a date, such as a space
+ * for Hebrew. */
+
+size_t parse_gregorian(const char *text, size_t length, int *rdate);
+size_t parse_iso(const char *text, size_t length, int *rdate);
+size_t parse_hebrew(const char *text, size_t length, int *rdate);
+size_t parse_islamic(const char *text, size_t length, int *rdate);
+size_t parse_mayan(const char *text, size_t length, int *rdate);
+size_t parse_chinese(const char *text, size_t length, int near, int *rdate);
+
+size_t parse_gregorian_n(const char *text, size_t length, char separator,
+                         int *dates, size_t max, size_t *consumed);
+size_t parse_iso_n(const char *text, size_t length, char separator,
+                   int *dates, size_t max, size_t *consumed);
+size_t parse_hebrew_n(const char *text, size_t length, char separator,
+                      int *dates, size_t max, size_t *consumed);
+size_t parse_islamic_n(const char *text, size_t length, char separator,
+                       int *dates, size_t max, size_t *consumed);
+size_t parse_mayan_n(const char *text, size_t length, char separator,
+                     int *dates, size_t max, size_t *consumed);
+size_t parse_chinese_n(const char *text, size_t length, char separator, int near,
+                       int *dates, size_t max, size_t *consumed);
+
+/* The name tables, looked up through perfect hashes built from them on
+   first use. Solar terms are known by their Chinese and English names. */
+enum ParseNames {
+    PARSE_HAAB_MONTHS,
+    PARSE_TZOLKIN_NAMES,
+    PARSE_STEMS,
+    PARSE_BRANCHES,
+    PARSE_HEBREW_MONTHS,
+    PARSE_ISLAMIC_MONTHS,
+    PARSE_MAJOR_SOLAR_TERMS,
+    PARSE_MINOR_SOLAR_TERMS,
+    PARSE_NAMES
+};
+
+/* The index of the name in its table, or 0 if it isn't there. */
+int parse_name(enum ParseNames table, const char *name, size_t length);
+
+#endif
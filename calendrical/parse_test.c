@@ -0,0 +1,78 @@
+/* Check parse.c on text that must be refused, and that the usual forms
+   take its fast paths. It includes parse.c to reach them.
+
+   usage: parse_test */
+
+#include <stdio.h>
+#include "parse.c"
+
+static int failures;
+
+static void expect_date(const char *text, int date)
+{
+    int got = 0;
+    size_t n = parse_gregorian(text, strlen(text), &got);
+    if (n != strlen(text) || got != date) {
+        printf("FAILED: \"%s\" gave %zu bytes, %d; wanted %d\n", text, n, got, date);
+        failures++;
+    }
+}
+
+static void expect_invalid(size_t (*parse)(const char *, size_t, int *), const char *text)
+{
+    int got = 0;
+    size_t n = parse(text, strlen(text), &got);
+    if (n != 0) {
+        printf("FAILED: \"%s\" gave %zu bytes, %d; wanted it refused\n", text, n, got);
+        failures++;
+    }
+}
+
+static void expect_fast(const char *text, bool fast)
+{
+    uint64_t x;
+    if (year_and_month(text, &x) != fast) {
+        printf("FAILED: \"%s\" %s the fast path\n", text, fast ? "missed" : "took");
+        failures++;
+    }
+}
+
+int main(void)
+{
+    /* Only '-' separates the fields. */
+    expect_invalid(parse_gregorian, "2020/01-05");
+    expect_invalid(parse_gregorian, "2020,01-05");
+    expect_invalid(parse_gregorian, "2020(01-05");
+    expect_invalid(parse_gregorian, "2024-01/05");
+
+    /* Every four-digit year takes the fast path, not only years ending in 0. */
+    expect_fast("2024-01-05", true);
+    expect_fast("2020-01-05", true);
+    expect_fast("1999-12-31", true);
+    expect_fast("2020/01-05", false);
+    expect_fast("2024-01/05", false);
+    expect_date("2024-01-05", fixed_from_gregorian(2024, 1, 5));
+    expect_date("1999-12-31", fixed_from_gregorian(1999, 12, 31));
+    expect_date("-0044-03-15", fixed_from_gregorian(-44, 3, 15));
+
+    /* Years whose fixed dates would overflow an int. */
+    expect_invalid(parse_gregorian, "999999999-01-01");
+    expect_invalid(parse_gregorian, "-5000001-01-01");
+    expect_date("5000000-12-31", fixed_from_gregorian(5000000, 12, 31));
+    expect_invalid(parse_iso, "999999999-W01-1");
+    expect_invalid(parse_hebrew, "1 Nisan 999999999");
+    expect_invalid(parse_islamic, "1 Muharram 999999999");
+    expect_invalid(parse_mayan, "99999.0.0.0.0");
+
+    /* Adar I only in a leap year; 5784 is one, 5783 isn't. */
+    expect_invalid(parse_hebrew, "1 Adar I 5783");
+    int date = 0;
+    if (parse_hebrew("1 Adar I 5784", 13, &date) != 13 ||
+        date != fixed_from_hebrew(5784, 12, 1)) {
+        printf("FAILED: \"1 Adar I 5784\" gave %d\n", date);
+        failures++;
+    }
+
+    printf(failures ? "%d failed\n" : "ok\n", failures);
+    return failures ? 1 : 0;
+}
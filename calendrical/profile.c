@@ -0,0 +1,237 @@
+/*
+ *  profile.c
+ *  The counters behind CALENDRICAL_PROFILE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "profile.h"
+
+static const char *profile_names[PROFILE_FUNCTIONS] = {
+    "solar_longitude",
+    "solar_longitude_after",
+    "estimate_prior_solar_longitude",
+    "lunar_longitude",
+    "lunar_latitude",
+    "nth_new_moon",
+    "new_moon_before",
+    "new_moon_after",
+    "chinese_winter_solstice_on_or_before",
+    "no_major_solar_term",
+    "prior_leap_month",
+    "chinese_new_year_in_sui",
+    "chinese_from_fixed",
+    "fixed_from_chinese",
+    "phasis_on_or_before",
+    "phase",
+    "truephase",
+    "kepler"
+};
+
+const char *calendrical_profile_name(enum ProfileFunction f)
+{
+    if (f < 0 || f >= PROFILE_FUNCTIONS) return NULL;
+    return profile_names[f];
+}
+
+/* Each thread counts only into its own counters, but a reset from
+   another thread zeroes them, so the counts are atomic adds (relaxed, as
+   nothing else is ordered by them) and no increment is lost to a reset. */
+static unsigned long long load(const unsigned long long *c)
+{
+    return __atomic_load_n(c, __ATOMIC_RELAXED);
+}
+
+static void store(unsigned long long *c, unsigned long long value)
+{
+    __atomic_store_n(c, value, __ATOMIC_RELAXED);
+}
+
+static void add_profile(struct CalendricalProfile *to, const struct CalendricalProfile *from)
+{
+    for (int i = 0; i < PROFILE_FUNCTIONS; i++) {
+        struct ProfileCounter *t = &to->functions[i];
+        const struct ProfileCounter *f = &from->functions[i];
+        t->calls += load(&f->calls);
+        t->iterations += load(&f->iterations);
+        t->nanoseconds += load(&f->nanoseconds);
+        for (int b = 0; b < PROFILE_BUCKETS; b++)
+            t->histogram[b] += load(&f->histogram[b]);
+    }
+}
+
+static void zero_profile(struct CalendricalProfile *p)
+{
+    for (int i = 0; i < PROFILE_FUNCTIONS; i++) {
+        struct ProfileCounter *c = &p->functions[i];
+        store(&c->calls, 0);
+        store(&c->iterations, 0);
+        store(&c->nanoseconds, 0);
+        for (int b = 0; b < PROFILE_BUCKETS; b++)
+            store(&c->histogram[b], 0);
+    }
+}
+
+struct ProfileThread {
+    struct CalendricalProfile counts;
+    struct ProfileThread *prev;
+    struct ProfileThread *next;
+};
+
+static pthread_mutex_t profile_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct ProfileThread *profile_threads;
+static struct CalendricalProfile profile_retired;  /* threads that have exited */
+
+#ifdef CALENDRICAL_PROFILE
+
+static void bump(unsigned long long *c, unsigned long long n)
+{
+    __atomic_fetch_add(c, n, __ATOMIC_RELAXED);
+}
+
+static pthread_key_t profile_key;
+static pthread_once_t profile_once = PTHREAD_ONCE_INIT;
+static __thread struct ProfileThread *profile_self;
+
+static void thread_exit(void *arg)
+{
+    struct ProfileThread *t = arg;
+    pthread_mutex_lock(&profile_lock);
+    add_profile(&profile_retired, &t->counts);
+    if (t->prev) t->prev->next = t->next;
+    else profile_threads = t->next;
+    if (t->next) t->next->prev = t->prev;
+    pthread_mutex_unlock(&profile_lock);
+    free(t);
+}
+
+static void make_key(void)
+{
+    pthread_key_create(&profile_key, thread_exit);
+}
+
+static struct ProfileThread *self(void)
+{
+    if (profile_self) return profile_self;
+    pthread_once(&profile_once, make_key);
+    struct ProfileThread *t = calloc(1, sizeof(*t));
+    if (t == NULL) return NULL;
+    pthread_mutex_lock(&profile_lock);
+    t->next = profile_threads;
+    if (profile_threads) profile_threads->prev = t;
+    profile_threads = t;
+    pthread_mutex_unlock(&profile_lock);
+    pthread_setspecific(profile_key, t);
+    profile_self = t;
+    return t;
+}
+
+static unsigned long long now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+struct ProfileScope profile_enter(enum ProfileFunction f)
+{
+    struct ProfileScope scope = { f, now() };
+    return scope;
+}
+
+void profile_leave(struct ProfileScope *scope)
+{
+    unsigned long long ns = now() - scope->start;
+    struct ProfileThread *t = self();
+    if (t == NULL) return;
+    struct ProfileCounter *c = &t->counts.functions[scope->function];
+    int bucket = ns ? 63 - __builtin_clzll(ns) : 0;
+    if (bucket >= PROFILE_BUCKETS) bucket = PROFILE_BUCKETS - 1;
+    bump(&c->calls, 1);
+    bump(&c->nanoseconds, ns);
+    bump(&c->histogram[bucket], 1);
+}
+
+void profile_iteration(enum ProfileFunction f)
+{
+    struct ProfileThread *t = self();
+    if (t == NULL) return;
+    struct ProfileCounter *c = &t->counts.functions[f];
+    bump(&c->iterations, 1);
+}
+
+#endif
+
+void calendrical_profile_snapshot(struct CalendricalProfile *p)
+{
+    memset(p, 0, sizeof(*p));
+    pthread_mutex_lock(&profile_lock);
+    add_profile(p, &profile_retired);
+    for (struct ProfileThread *t = profile_threads; t; t = t->next)
+        add_profile(p, &t->counts);
+    pthread_mutex_unlock(&profile_lock);
+}
+
+void calendrical_profile_thread_snapshot(struct CalendricalProfile *p)
+{
+    memset(p, 0, sizeof(*p));
+#ifdef CALENDRICAL_PROFILE
+    struct ProfileThread *t = self();
+    if (t) add_profile(p, &t->counts);
+#endif
+}
+
+void calendrical_profile_reset(void)
+{
+    pthread_mutex_lock(&profile_lock);
+    zero_profile(&profile_retired);
+    for (struct ProfileThread *t = profile_threads; t; t = t->next)
+        zero_profile(&t->counts);
+    pthread_mutex_unlock(&profile_lock);
+}
+
+unsigned long long calendrical_profile_percentile(const struct ProfileCounter *c,
+                                                  double fraction)
+{
+    if (c->calls == 0) return 0;
+    unsigned long long want = (unsigned long long)(fraction * c->calls);
+    unsigned long long seen = 0;
+    for (int b = 0; b < PROFILE_BUCKETS; b++) {
+        seen += c->histogram[b];
+        if (seen > want || seen == c->calls) return 2ULL << b;
+    }
+    return 2ULL << (PROFILE_BUCKETS - 1);
+}
+
+void calendrical_profile_print(FILE *f, const struct CalendricalProfile *p)
+{
+    fprintf(f, "%-38s %12s %12s %10s %10s %10s\n", "function", "calls",
+            "iterations", "mean ns", "p50 ns", "p99 ns");
+    for (int i = 0; i < PROFILE_FUNCTIONS; i++) {
+        const struct ProfileCounter *c = &p->functions[i];
+        if (c->calls == 0) continue;
+        fprintf(f, "%-38s %12llu %12llu %10llu %10llu %10llu\n",
+                profile_names[i], c->calls, c->iterations,
+                c->nanoseconds / c->calls,
+                calendrical_profile_percentile(c, 0.5),
+                calendrical_profile_percentile(c, 0.99));
+    }
+}
+
+void calendrical_profile_print_json(FILE *f, const struct CalendricalProfile *p)
+{
+    fprintf(f, "{");
+    for (int i = 0; i < PROFILE_FUNCTIONS; i++) {
+        const struct ProfileCounter *c = &p->functions[i];
+        fprintf(f, "%s\n  \"%s\": { \"calls\": %llu, \"iterations\": %llu, "
+                "\"nanoseconds\": %llu, \"histogram\": [",
+                i ? "," : "", profile_names[i],
+                c->calls, c->iterations, c->nanoseconds);
+        for (int b = 0; b < PROFILE_BUCKETS; b++)
+            fprintf(f, "%s%llu", b ? ", " : "", c->histogram[b]);
+        fprintf(f, "] }");
+    }
+    fprintf(f, "\n}\n");
+}
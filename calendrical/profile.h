@@ -0,0 +1,96 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdio.h>
+
+/* Call counts, inner loop iterations and latency histograms for the
+ * expensive astronomical functions.
+ *
+ * Nothing is recorded unless the library is compiled with
+ * CALENDRICAL_PROFILE defined; otherwise the hooks compile to nothing and
+ * a snapshot is all zeros. Counters are kept per thread. A snapshot
+ * adds up every thread, including ones that have exited.
+ *
+ * Needs GCC or clang, and POSIX threads. */
+
+enum ProfileFunction {
+    PROFILE_SOLAR_LONGITUDE,
+    PROFILE_SOLAR_LONGITUDE_AFTER,      /* iterations: bisection steps */
+    PROFILE_ESTIMATE_PRIOR_SOLAR_LONGITUDE,
+    PROFILE_LUNAR_LONGITUDE,
+    PROFILE_LUNAR_LATITUDE,
+    PROFILE_NTH_NEW_MOON,
+    PROFILE_NEW_MOON_BEFORE,
+    PROFILE_NEW_MOON_AFTER,
+    PROFILE_CHINESE_WINTER_SOLSTICE,    /* iterations: days stepped */
+    PROFILE_NO_MAJOR_SOLAR_TERM,
+    PROFILE_PRIOR_LEAP_MONTH,           /* calls include the recursion */
+    PROFILE_CHINESE_NEW_YEAR_IN_SUI,
+    PROFILE_CHINESE_FROM_FIXED,
+    PROFILE_FIXED_FROM_CHINESE,
+    PROFILE_PHASIS_ON_OR_BEFORE,        /* iterations: days tested */
+    PROFILE_PHASE,
+    PROFILE_TRUEPHASE,
+    PROFILE_KEPLER,                     /* iterations: Newton steps */
+    PROFILE_FUNCTIONS
+};
+
+/* Latency histogram buckets are powers of two nanoseconds:
+   bucket i counts calls taking [2^i, 2^(i+1)) ns. */
+#define PROFILE_BUCKETS 32
+
+struct ProfileCounter {
+    unsigned long long calls;
+    unsigned long long iterations;
+    unsigned long long nanoseconds;
+    unsigned long long histogram[PROFILE_BUCKETS];
+};
+
+struct CalendricalProfile {
+    struct ProfileCounter functions[PROFILE_FUNCTIONS];
+};
+
+const char *calendrical_profile_name(enum ProfileFunction f);
+
+/* All threads, or just the calling one. */
+void calendrical_profile_snapshot(struct CalendricalProfile *p);
+void calendrical_profile_thread_snapshot(struct CalendricalProfile *p);
+
+/* Zero every thread's counters. Calls in progress in other threads
+   may still land on either side of the reset. */
+void calendrical_profile_reset(void);
+
+/* Latency below which the given fraction (0 to 1) of calls fall,
+   to the resolution of the histogram. */
+unsigned long long calendrical_profile_percentile(const struct ProfileCounter *c,
+                                                  double fraction);
+
+void calendrical_profile_print(FILE *f, const struct CalendricalProfile *p);
+void calendrical_profile_print_json(FILE *f, const struct CalendricalProfile *p);
+
+/* Hooks used inside the library. */
+#ifdef CALENDRICAL_PROFILE
+
+struct ProfileScope {
+    enum ProfileFunction function;
+    unsigned long long start;
+};
+
+struct ProfileScope profile_enter(enum ProfileFunction f);
+void profile_leave(struct ProfileScope *scope);
+void profile_iteration(enum ProfileFunction f);
+
+/* Times the rest of the enclosing function, whichever way it returns. */
+#define PROFILE_FUNCTION(f) \
+    struct ProfileScope profile_scope_ \
+        __attribute__((cleanup(profile_leave))) = profile_enter(f)
+#define PROFILE_ITERATION(f) profile_iteration(f)
+
+#else
+
+#define PROFILE_FUNCTION(f)
+#define PROFILE_ITERATION(f)
+
+#endif
+
+#endif
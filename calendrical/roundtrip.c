@@ -0,0 +1,74 @@
+/* Check that each calendar converts to and from fixed dates and back,
+   and report how fast it does so.
+
+   usage: roundtrip [calendar [from to]] [-j threads]
+
+   With no calendar, the arithmetic calendars are swept over fixed dates
+   -10,000,000 to 10,000,000, and the astronomical ones over 1900-2100. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "calendar.h"
+#include "verify.h"
+
+static bool check(enum VerifyCalendar cal, int from, int to, int threads)
+{
+    struct VerifyResult r;
+    bool ok = verify_round_trip(cal, from, to, threads, &r);
+
+    printf("%-22s %d..%d: %lld dates, %.3g/s from fixed, %.3g/s to fixed per thread",
+           verify_calendar_name(cal), from, to, r.checked,
+           r.from_fixed_rate, r.to_fixed_rate);
+    if (r.failed) {
+        printf("\n  FAILED at %d: %s; got %d %d %d %d %d, which gives %d\n",
+               r.date, r.reason, r.fields[0], r.fields[1], r.fields[2],
+               r.fields[3], r.fields[4], r.round_trip);
+    } else if (!ok) {
+        printf("\n  FAILED: %s\n", r.reason);
+    } else {
+        printf(": ok\n");
+    }
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    int threads = 0;
+    const char *name = NULL;
+    int from = 0, to = 0, bounds = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (name == NULL) name = argv[i];
+        else if (bounds == 0) { from = atoi(argv[i]); bounds++; }
+        else if (bounds == 1) { to = atoi(argv[i]); bounds++; }
+    }
+
+    bool ok = true;
+    if (name) {
+        int cal;
+        for (cal = 0; cal < VERIFY_CALENDARS; cal++)
+            if (strcmp(name, verify_calendar_name(cal)) == 0) break;
+        if (cal == VERIFY_CALENDARS || bounds == 1) {
+            fprintf(stderr, "usage: roundtrip [calendar [from to]] [-j threads]\n");
+            return 2;
+        }
+        if (bounds == 0) {
+            bool astronomical = cal >= VERIFY_CHINESE;
+            from = astronomical ? fixed_from_gregorian(1900, 1, 1) : -10000000;
+            to = astronomical ? fixed_from_gregorian(2100, 12, 31) : 10000000;
+        }
+        ok = check(cal, from, to, threads);
+    } else {
+        for (int cal = 0; cal < VERIFY_CHINESE; cal++)
+            ok = check(cal, -10000000, 10000000, threads) && ok;
+        ok = check(VERIFY_CHINESE, fixed_from_gregorian(1900, 1, 1),
+                   fixed_from_gregorian(2100, 12, 31), threads) && ok;
+        ok = check(VERIFY_OBSERVATIONAL_ISLAMIC, fixed_from_gregorian(1900, 1, 1),
+                   fixed_from_gregorian(2100, 12, 31), threads) && ok;
+        ok = check(VERIFY_PERSIAN, fixed_from_gregorian(1900, 1, 1),
+                   fixed_from_gregorian(2100, 12, 31), threads) && ok;
+    }
+    return ok ? 0 : 1;
+}
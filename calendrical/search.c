@@ -0,0 +1,331 @@
+/*
+ *  search.c
+ *  Finding the dates that match a DateQuery.
+ *
+ *  Each field of a query can say, for any date, the first date on or
+ *  after it that the field allows: the weekday and Mayan fields by their
+ *  cycles, the calendar fields by walking a year's months. Taking turns
+ *  moving the date forward until no field moves it finds the first date
+ *  they all allow, converting only as many years as the matches span.
+ */
+
+#ifndef CALENDRICAL_INLINE
+#define CALENDRICAL_INLINE
+#endif
+#include "search.h"
+
+enum {
+    GREGORIAN,
+    JULIAN,
+    ISLAMIC,
+    HEBREW,
+    CHINESE,
+    CALENDARS,
+    WEEKDAY = CALENDARS,
+    TZOLKIN,
+    HAAB,
+    FIELDS
+};
+
+/* The months of one year of a calendar, in order. */
+struct Year {
+    int year;
+    int months;                 /* 0 until worked out */
+    int month_start[14];        /* month_start[months] is the next new year */
+    int month[13];
+    bool leap[13];
+};
+
+struct Search {
+    const struct DateQuery *query;
+    int fields[FIELDS];
+    int count;
+    struct Year years[CALENDARS];
+};
+
+static const struct MonthDayQuery *calendar_query(const struct DateQuery *query,
+                                                  int calendar)
+{
+    switch (calendar) {
+        case GREGORIAN: return &query->gregorian;
+        case JULIAN: return &query->julian;
+        case ISLAMIC: return &query->islamic;
+        case HEBREW: return &query->hebrew;
+        default: return &query->chinese;
+    }
+}
+
+void date_query_any(struct DateQuery *query)
+{
+    query->weekday = QUERY_ANY;
+    struct MonthDayQuery *q[] = { &query->gregorian, &query->julian,
+        &query->islamic, &query->hebrew, &query->chinese };
+    for (int c = 0; c < CALENDARS; c++)
+        q[c]->month = q[c]->day = q[c]->leap = QUERY_ANY;
+    query->tzolkin_number = query->tzolkin_name = QUERY_ANY;
+    query->haab_month = query->haab_day = QUERY_ANY;
+}
+
+static bool field_matches(int field, int value)
+{
+    return field == QUERY_ANY || field == value;
+}
+
+static bool month_day_matches(const struct MonthDayQuery *q, int month, bool leap, int day)
+{
+    return field_matches(q->month, month) && field_matches(q->leap, leap) &&
+        field_matches(q->day, day);
+}
+
+bool date_query_matches(const struct DateQuery *query, int date)
+{
+    int year, month, day, number, name;
+    if (!field_matches(query->weekday, day_of_week_from_fixed(date))) return false;
+
+    for (int c = 0; c < CALENDARS; c++) {
+        const struct MonthDayQuery *q = calendar_query(query, c);
+        if (q->month == QUERY_ANY && q->day == QUERY_ANY && q->leap == QUERY_ANY)
+            continue;
+        bool leap = false;
+        switch (c) {
+            case GREGORIAN: gregorian_from_fixed(date, &year, &month, &day); break;
+            case JULIAN: julian_from_fixed(date, &year, &month, &day); break;
+            case ISLAMIC: islamic_from_fixed(date, &year, &month, &day); break;
+            case HEBREW: hebrew_from_fixed(date, &year, &month, &day); break;
+            default: {
+                struct ChineseDate cdate;
+                chinese_from_fixed(date, &cdate);
+                month = cdate.month;
+                leap = cdate.leap;
+                day = cdate.day;
+            }
+        }
+        if (!month_day_matches(q, month, leap, day)) return false;
+    }
+
+    if (query->tzolkin_number != QUERY_ANY || query->tzolkin_name != QUERY_ANY) {
+        mayan_tzolkin_from_fixed(date, &number, &name);
+        if (!field_matches(query->tzolkin_number, number) ||
+            !field_matches(query->tzolkin_name, name)) return false;
+    }
+    if (query->haab_month != QUERY_ANY || query->haab_day != QUERY_ANY) {
+        mayan_haab_from_fixed(date, &month, &day);
+        if (!field_matches(query->haab_month, month) ||
+            !field_matches(query->haab_day, day)) return false;
+    }
+    return true;
+}
+
+#pragma mark Years
+
+static void arithmetic_year(int calendar, int year, struct Year *y)
+{
+    y->year = year;
+    y->months = 12;
+    for (int i = 0; i <= 12; i++) {
+        int m = i < 12 ? i + 1 : 1, yy = i < 12 ? year : year + 1;
+        switch (calendar) {
+            case GREGORIAN: y->month_start[i] = fixed_from_gregorian(yy, m, 1); break;
+            case JULIAN:
+                if (yy == 0) yy = 1;
+                y->month_start[i] = fixed_from_julian(yy, m, 1);
+                break;
+            default: y->month_start[i] = fixed_from_islamic(yy, m, 1); break;
+        }
+        if (i < 12) {
+            y->month[i] = m;
+            y->leap[i] = false;
+        }
+    }
+}
+
+static void hebrew_year(int year, struct Year *y)
+{
+    struct HebrewYearInfo info;
+    hebrew_year_info(year, &info);
+    y->year = year;
+    y->months = info.months;
+    for (int i = 0; i <= info.months; i++) y->month_start[i] = info.month_start[i];
+    for (int i = 0; i < info.months; i++) {
+        y->month[i] = i < info.months - 6 ? i + 7 : i - info.months + 7;
+        y->leap[i] = false;
+    }
+}
+
+static void chinese_year(int date, struct Year *y)
+{
+    struct ChineseYearInfo info;
+    chinese_year_info(date, &info);
+    y->year = 60 * info.cycle + info.year;
+    y->months = info.months;
+    for (int i = 0; i <= info.months; i++) y->month_start[i] = info.month_start[i];
+    for (int i = 0; i < info.months; i++) {
+        y->month[i] = (info.leap_month < 0 || i < info.leap_month) ? i + 1 : i;
+        y->leap[i] = i == info.leap_month;
+    }
+}
+
+/* Make y the year of date. Searches mostly move on to the next year, so
+   that's tried before converting date. */
+static void year_of(int calendar, int date, struct Year *y)
+{
+    if (y->months > 0 && date >= y->month_start[0] && date < y->month_start[y->months])
+        return;
+    bool next = y->months > 0 && date >= y->month_start[y->months] &&
+        date < y->month_start[y->months] + 366;
+    int year;
+
+    switch (calendar) {
+        case GREGORIAN:
+            arithmetic_year(calendar, gregorian_year_from_fixed(date), y);
+            return;
+        case JULIAN:
+        case ISLAMIC:
+            if (calendar == JULIAN) julian_from_fixed(date, &year, NULL, NULL);
+            else islamic_from_fixed(date, &year, NULL, NULL);
+            arithmetic_year(calendar, year, y);
+            return;
+        case HEBREW:
+            if (next) hebrew_year(y->year + 1, y);
+            if (next && date < y->month_start[y->months]) return;
+            hebrew_from_fixed(date, &year, NULL, NULL);
+            hebrew_year(year, y);
+            return;
+        default:
+            chinese_year(date, y);
+            return;
+    }
+}
+
+#pragma mark Fields
+
+/* The first date on or after date allowed by q, walking the months of
+   each year from date's. */
+static int next_in_calendar(const struct MonthDayQuery *q, int calendar,
+                            struct Year *y, int date, int to)
+{
+    /* No month in these calendars is longer than 31 days. */
+    if (q->day != QUERY_ANY && (q->day < 1 || q->day > 31)) return to;
+    while (date < to) {
+        year_of(calendar, date, y);
+        for (int i = 0; i < y->months; i++) {
+            int start = y->month_start[i], end = y->month_start[i + 1];
+            if (end <= date || !field_matches(q->month, y->month[i]) ||
+                !field_matches(q->leap, y->leap[i]))
+                continue;
+            if (q->day == QUERY_ANY) return start > date ? start : date;
+            int d = start + q->day - 1;
+            if (d < end && d >= date) return d;
+        }
+        date = y->month_start[y->months];
+    }
+    return to;
+}
+
+static int next_tzolkin(const struct DateQuery *q, int date, int to)
+{
+    int number, name;
+    if ((q->tzolkin_number != QUERY_ANY && (q->tzolkin_number < 1 || q->tzolkin_number > 13)) ||
+        (q->tzolkin_name != QUERY_ANY && (q->tzolkin_name < 1 || q->tzolkin_name > 20)))
+        return to;
+    if (q->tzolkin_number != QUERY_ANY && q->tzolkin_name != QUERY_ANY)
+        return mayan_tzolkin_on_or_before(date + 259, q->tzolkin_number, q->tzolkin_name);
+    mayan_tzolkin_from_fixed(date, &number, &name);
+    if (q->tzolkin_number != QUERY_ANY)
+        return date + calendrical_mod(q->tzolkin_number - number, 13);
+    return date + calendrical_mod(q->tzolkin_name - name, 20);
+}
+
+/* The haab is 18 months of 20 days and Uayeb, the 19th, of 5. */
+static int next_haab(const struct DateQuery *q, int date, int to)
+{
+    int month, day;
+    if (q->haab_month != QUERY_ANY && (q->haab_month < 1 || q->haab_month > 19)) return to;
+    if (q->haab_day != QUERY_ANY && (q->haab_day < 0 || q->haab_day > 19 ||
+        (q->haab_month == 19 && q->haab_day > 4))) return to;
+
+    if (q->haab_month != QUERY_ANY && q->haab_day != QUERY_ANY)
+        return mayan_haab_on_or_before(date + 364, q->haab_month, q->haab_day);
+    mayan_haab_from_fixed(date, &month, &day);
+    int ordinal = 20 * (month - 1) + day;
+    if (q->haab_month != QUERY_ANY) {
+        if (month == q->haab_month) return date;
+        return date + calendrical_mod(20 * (q->haab_month - 1) - ordinal, 365);
+    }
+    int step = calendrical_mod(q->haab_day - day, 20);
+    if (ordinal + step < 365) return date + step;
+    return date + 365 - ordinal + q->haab_day;        /* into next year's Pop */
+}
+
+static int next_for_field(struct Search *s, int field, int date, int to)
+{
+    const struct DateQuery *q = s->query;
+    switch (field) {
+        case WEEKDAY:
+            if (q->weekday < 0 || q->weekday > 6) return to;
+            return kday_on_or_after(date, q->weekday);
+        case TZOLKIN: return next_tzolkin(q, date, to);
+        case HAAB: return next_haab(q, date, to);
+        default:
+            return next_in_calendar(calendar_query(q, field), field,
+                                    &s->years[field], date, to);
+    }
+}
+
+#pragma mark Search
+
+static void search_init(struct Search *s, const struct DateQuery *query)
+{
+    s->query = query;
+    s->count = 0;
+    /* The cheap cycles first, so that they narrow the dates the
+       calendars need to look at. */
+    if (query->weekday != QUERY_ANY) s->fields[s->count++] = WEEKDAY;
+    if (query->tzolkin_number != QUERY_ANY || query->tzolkin_name != QUERY_ANY)
+        s->fields[s->count++] = TZOLKIN;
+    if (query->haab_month != QUERY_ANY || query->haab_day != QUERY_ANY)
+        s->fields[s->count++] = HAAB;
+    for (int c = 0; c < CALENDARS; c++) {
+        const struct MonthDayQuery *q = calendar_query(query, c);
+        if (q->month != QUERY_ANY || q->day != QUERY_ANY || q->leap != QUERY_ANY)
+            s->fields[s->count++] = c;
+        s->years[c].months = 0;
+    }
+}
+
+static int search_next(struct Search *s, int date, int to)
+{
+    if (s->count == 0) return date < to ? date : to;
+    /* Go round the fields until as many in a row as there are leave
+       the date where it is. */
+    for (int i = 0, agreed = 0; ; i = (i + 1) % s->count) {
+        int next = next_for_field(s, s->fields[i], date, to);
+        if (next >= to) return to;
+        if (next != date) {
+            date = next;
+            agreed = 0;
+        }
+        if (++agreed == s->count) return date;
+    }
+}
+
+int date_query_next(const struct DateQuery *query, int from, int to)
+{
+    struct Search s;
+    search_init(&s, query);
+    return search_next(&s, from, to);
+}
+
+size_t date_query_find(const struct DateQuery *query, int from, int to,
+                       int *dates, size_t max)
+{
+    struct Search s;
+    size_t count = 0;
+    search_init(&s, query);
+    for (int date = from; count < max; date++) {
+        date = search_next(&s, date, to);
+        if (date >= to) break;
+        dates[count++] = date;
+    }
+    return count;
+}
@@ -0,0 +1,54 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "calendar.h"
+
+/* Finding the dates that match a pattern: every Friday the 13th, every
+ * Chinese leap month, every Passover on a Saturday, every 4 Ahau.
+ *
+ * A query is a set of fields, each QUERY_ANY or a value that must match;
+ * a date matches if all of them do. Months and days are numbered as in
+ * the rest of the library. leap applies to the Chinese calendar only.
+ *
+ * The search doesn't convert each day in the range. Each field jumps to
+ * the next date it allows, by the calendar's months and cycles, and the
+ * fields take turns until they agree. */
+
+#define QUERY_ANY (-1)
+
+struct MonthDayQuery {
+    int month;
+    int day;
+    int leap;                       /* 1 for a leap month, 0 for not */
+};
+
+struct DateQuery {
+    int weekday;                    /* 0 (Sunday) to 6 */
+    struct MonthDayQuery gregorian;
+    struct MonthDayQuery julian;
+    struct MonthDayQuery islamic;
+    struct MonthDayQuery hebrew;
+    struct MonthDayQuery chinese;
+    int tzolkin_number;             /* 1 to 13 */
+    int tzolkin_name;               /* 1 to 20 */
+    int haab_month;                 /* 1 to 19 */
+    int haab_day;                   /* 0 to 19 */
+};
+
+/* Sets every field to QUERY_ANY. */
+void date_query_any(struct DateQuery *query);
+
+/* Converts date to each calendar the query mentions and checks it. */
+bool date_query_matches(const struct DateQuery *query, int date);
+
+/* The first date in [from, to) that matches, or to if none does. */
+int date_query_next(const struct DateQuery *query, int from, int to);
+
+/* Up to max of the matching dates in [from, to), in order. Returns how
+   many were written. */
+size_t date_query_find(const struct DateQuery *query, int from, int to,
+                       int *dates, size_t max);
+
+#endif
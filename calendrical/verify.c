@@ -0,0 +1,319 @@
+/*
+ *  verify.c
+ *  Parallel round-trip checks and conversion throughput.
+ */
+
+#include <stdlib.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "calendar.h"
+#include "calendar64.h"
+#include "verify.h"
+
+#pragma mark Calendars
+
+/* Each calendar is seen as up to five fields, biggest unit first, the
+   last of which counts days within the rest. */
+struct VerifyCalendarInfo {
+    const char *name;
+    int fields;
+    int first_day;
+    void (*from_fixed)(int date, int *f);
+    int (*to_fixed)(const int *f);
+    int (*last_day)(const int *f);      /* NULL when not known in advance */
+};
+
+static void gregorian_fields(int date, int *f) { gregorian_from_fixed(date, &f[0], &f[1], &f[2]); }
+static int gregorian_fixed(const int *f) { return fixed_from_gregorian(f[0], f[1], f[2]); }
+static int gregorian_last(const int *f) { return last_day_of_gregorian_month(f[1], f[0]); }
+
+static void julian_fields(int date, int *f) { julian_from_fixed(date, &f[0], &f[1], &f[2]); }
+static int julian_fixed(const int *f) { return fixed_from_julian(f[0], f[1], f[2]); }
+static int julian_last(const int *f) { return last_day_of_julian_month(f[1], f[0]); }
+
+static void iso_fields(int date, int *f) { iso_from_fixed(date, &f[0], &f[1], &f[2]); }
+static int iso_fixed(const int *f) { return fixed_from_iso(f[0], f[1], f[2]); }
+static int iso_last(const int *f) { (void)f; return 7; }
+
+static void islamic_fields(int date, int *f) { islamic_from_fixed(date, &f[0], &f[1], &f[2]); }
+static int islamic_fixed(const int *f) { return fixed_from_islamic(f[0], f[1], f[2]); }
+static int islamic_last(const int *f) { return last_day_of_islamic_month(f[1], f[0]); }
+
+static void hebrew_fields(int date, int *f) { hebrew_from_fixed(date, &f[0], &f[1], &f[2]); }
+static int hebrew_fixed(const int *f) { return fixed_from_hebrew(f[0], f[1], f[2]); }
+static int hebrew_last(const int *f) { return last_day_of_hebrew_month(f[1], f[0]); }
+
+static void mayan_fields(int date, int *f)
+{
+    mayan_long_count_from_fixed(date, &f[0], &f[1], &f[2], &f[3], &f[4]);
+}
+static int mayan_fixed(const int *f) { return fixed_from_mayan_long_count(f[0], f[1], f[2], f[3], f[4]); }
+static int mayan_last(const int *f) { (void)f; return 19; }
+
+/* The int64_t functions, over dates an int holds. */
+static void gregorian64_fields(int date, int *f)
+{
+    int64_t year;
+    gregorian_from_fixed64(date, &year, &f[1], &f[2]);
+    f[0] = (int)year;
+}
+static int gregorian64_fixed(const int *f) { return (int)fixed_from_gregorian64(f[0], f[1], f[2]); }
+
+static void julian64_fields(int date, int *f)
+{
+    int64_t year;
+    julian_from_fixed64(date, &year, &f[1], &f[2]);
+    f[0] = (int)year;
+}
+static int julian64_fixed(const int *f) { return (int)fixed_from_julian64(f[0], f[1], f[2]); }
+
+static void iso64_fields(int date, int *f)
+{
+    int64_t year;
+    iso_from_fixed64(date, &year, &f[1], &f[2]);
+    f[0] = (int)year;
+}
+static int iso64_fixed(const int *f) { return (int)fixed_from_iso64(f[0], f[1], f[2]); }
+
+static void islamic64_fields(int date, int *f)
+{
+    int64_t year;
+    islamic_from_fixed64(date, &year, &f[1], &f[2]);
+    f[0] = (int)year;
+}
+static int islamic64_fixed(const int *f) { return (int)fixed_from_islamic64(f[0], f[1], f[2]); }
+
+static void hebrew64_fields(int date, int *f)
+{
+    int64_t year;
+    hebrew_from_fixed64(date, &year, &f[1], &f[2]);
+    f[0] = (int)year;
+}
+static int hebrew64_fixed(const int *f) { return (int)fixed_from_hebrew64(f[0], f[1], f[2]); }
+
+static void mayan64_fields(int date, int *f)
+{
+    int64_t baktun;
+    mayan_long_count_from_fixed64(date, &baktun, &f[1], &f[2], &f[3], &f[4]);
+    f[0] = (int)baktun;
+}
+static int mayan64_fixed(const int *f)
+{
+    return (int)fixed_from_mayan_long_count64(f[0], f[1], f[2], f[3], f[4]);
+}
+
+static void chinese_fields(int date, int *f)
+{
+    struct ChineseDate c;
+    chinese_from_fixed(date, &c);
+    f[0] = c.cycle;
+    f[1] = c.year;
+    f[2] = c.month;
+    f[3] = c.leap;
+    f[4] = c.day;
+}
+static int chinese_fixed(const int *f)
+{
+    struct ChineseDate c = { f[0], f[1], f[2], f[3], f[4] };
+    return fixed_from_chinese(c);
+}
+
+static void observational_islamic_fields(int date, int *f)
+{
+    observational_islamic_from_fixed(date, IslamicLocation, &f[0], &f[1], &f[2]);
+}
+static int observational_islamic_fixed(const int *f)
+{
+    return fixed_from_observational_islamic(f[0], f[1], f[2], IslamicLocation);
+}
+
+static void persian_fields(int date, int *f) { persian_from_fixed(date, &f[0], &f[1], &f[2]); }
+static int persian_fixed(const int *f) { return fixed_from_persian(f[0], f[1], f[2]); }
+
+static const struct VerifyCalendarInfo calendars[VERIFY_CALENDARS] = {
+    { "gregorian", 3, 1, gregorian_fields, gregorian_fixed, gregorian_last },
+    { "julian", 3, 1, julian_fields, julian_fixed, julian_last },
+    { "iso", 3, 1, iso_fields, iso_fixed, iso_last },
+    { "islamic", 3, 1, islamic_fields, islamic_fixed, islamic_last },
+    { "hebrew", 3, 1, hebrew_fields, hebrew_fixed, hebrew_last },
+    { "mayan", 5, 0, mayan_fields, mayan_fixed, mayan_last },
+    { "gregorian64", 3, 1, gregorian64_fields, gregorian64_fixed, gregorian_last },
+    { "julian64", 3, 1, julian64_fields, julian64_fixed, julian_last },
+    { "iso64", 3, 1, iso64_fields, iso64_fixed, iso_last },
+    { "islamic64", 3, 1, islamic64_fields, islamic64_fixed, islamic_last },
+    { "hebrew64", 3, 1, hebrew64_fields, hebrew64_fixed, hebrew_last },
+    { "mayan64", 5, 0, mayan64_fields, mayan64_fixed, mayan_last },
+    { "chinese", 5, 1, chinese_fields, chinese_fixed, NULL },
+    { "observational-islamic", 3, 1, observational_islamic_fields,
+      observational_islamic_fixed, NULL },
+    { "persian", 3, 1, persian_fields, persian_fixed, NULL }
+};
+
+const char *verify_calendar_name(enum VerifyCalendar cal)
+{
+    if (cal < 0 || cal >= VERIFY_CALENDARS) return NULL;
+    return calendars[cal].name;
+}
+
+#pragma mark Checking
+
+/* Why f, the fields for some date, can't follow p, those for the day
+   before; NULL if it can. */
+static const char *successor_error(const struct VerifyCalendarInfo *cal,
+                                   const int *p, const int *f)
+{
+    int day = cal->fields - 1;
+    bool same_month = true;
+    for (int i = 0; i < day; i++)
+        if (p[i] != f[i]) same_month = false;
+
+    if (f[day] == cal->first_day) {
+        if (same_month) return "month didn't change on its first day";
+        if (cal->last_day && p[day] != cal->last_day(p))
+            return "month changed before its last day";
+        return NULL;
+    }
+    if (!same_month) return "month changed after its first day";
+    if (f[day] != p[day] + 1) return "day didn't follow the day before";
+    return NULL;
+}
+
+#define CHUNK 4096
+
+struct Sweep {
+    const struct VerifyCalendarInfo *cal;
+    int from;
+    int to;
+    long long next;             /* next chunk to hand out */
+    int first_bad;              /* INT_MAX until something fails */
+
+    pthread_mutex_t lock;       /* guards the rest */
+    struct VerifyResult *result;
+    long long checked;
+    double from_seconds;
+    double to_seconds;
+};
+
+static double seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void fail(struct Sweep *s, int date, const int *f, int round_trip,
+                 const char *reason)
+{
+    pthread_mutex_lock(&s->lock);
+    if (date < s->first_bad) {
+        __atomic_store_n(&s->first_bad, date, __ATOMIC_RELAXED);
+        struct VerifyResult *r = s->result;
+        r->failed = true;
+        r->date = date;
+        for (int i = 0; i < 5; i++) r->fields[i] = i < s->cal->fields ? f[i] : 0;
+        r->round_trip = round_trip;
+        r->reason = reason;
+    }
+    pthread_mutex_unlock(&s->lock);
+}
+
+/* Chunks go out in order, so once one starts past a failure every
+   later one does too, and the first failure found in the chunks
+   already out is the first overall. */
+static void *sweep_thread(void *arg)
+{
+    struct Sweep *s = arg;
+    const struct VerifyCalendarInfo *cal = s->cal;
+    int (*f)[5] = malloc((CHUNK + 1) * sizeof(*f));
+    int *fixed = malloc(CHUNK * sizeof(int));
+    long long checked = 0;
+    double from_seconds = 0, to_seconds = 0;
+
+    if (f == NULL || fixed == NULL) {
+        free(f);
+        free(fixed);
+        return NULL;
+    }
+
+    for (;;) {
+        long long k = __atomic_fetch_add(&s->next, 1, __ATOMIC_RELAXED);
+        long long start = s->from + k * CHUNK;
+        if (start > s->to || start > __atomic_load_n(&s->first_bad, __ATOMIC_RELAXED))
+            break;
+        int n = s->to - start + 1 < CHUNK ? (int)(s->to - start + 1) : CHUNK;
+
+        /* f[0] is the day before the chunk, to check the first day against. */
+        double t0 = seconds();
+        for (int i = 0; i <= n; i++) cal->from_fixed((int)start + i - 1, f[i]);
+        double t1 = seconds();
+        for (int i = 0; i < n; i++) fixed[i] = cal->to_fixed(f[i + 1]);
+        double t2 = seconds();
+        from_seconds += t1 - t0;
+        to_seconds += t2 - t1;
+        checked += n;
+
+        for (int i = 0; i < n; i++) {
+            int date = (int)start + i;
+            const char *reason = NULL;
+            if (fixed[i] != date) reason = "fixed_from doesn't give the date back";
+            else reason = successor_error(cal, f[i], f[i + 1]);
+            if (reason) {
+                fail(s, date, f[i + 1], fixed[i], reason);
+                break;
+            }
+        }
+    }
+
+    pthread_mutex_lock(&s->lock);
+    s->checked += checked;
+    s->from_seconds += from_seconds;
+    s->to_seconds += to_seconds;
+    pthread_mutex_unlock(&s->lock);
+    free(f);
+    free(fixed);
+    return NULL;
+}
+
+bool verify_round_trip(enum VerifyCalendar cal, int from, int to, int threads,
+                       struct VerifyResult *result)
+{
+    struct VerifyResult r = { 0 };
+    if (cal < 0 || cal >= VERIFY_CALENDARS || to < from) {
+        if (result) *result = r;
+        return cal >= 0 && cal < VERIFY_CALENDARS;
+    }
+
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+    long long chunks = ((long long)to - from) / CHUNK + 1;
+    if (threads > chunks) threads = (int)chunks;
+
+    struct Sweep s = {
+        .cal = &calendars[cal], .from = from, .to = to,
+        .next = 0, .first_bad = INT_MAX, .result = &r
+    };
+    pthread_mutex_init(&s.lock, NULL);
+
+    pthread_t *ids = malloc(threads * sizeof(*ids));
+    int started = 0;
+    if (ids)
+        while (started < threads - 1 &&
+               pthread_create(&ids[started], NULL, sweep_thread, &s) == 0)
+            started++;
+    sweep_thread(&s);
+    for (int i = 0; i < started; i++) pthread_join(ids[i], NULL);
+    free(ids);
+    pthread_mutex_destroy(&s.lock);
+
+    r.checked = s.checked;
+    if (s.from_seconds > 0) r.from_fixed_rate = s.checked / s.from_seconds;
+    if (s.to_seconds > 0) r.to_fixed_rate = s.checked / s.to_seconds;
+    if (!r.failed && s.checked < (long long)to - from + 1)
+        r.reason = "out of memory";
+    if (result) *result = r;
+    return !r.failed && r.reason == NULL;
+}
@@ -0,0 +1,52 @@
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include <stdbool.h>
+
+/* Round-trip checks over a range of fixed dates, in parallel.
+ *
+ * For every date d in the range this checks that fixed_from_X(X_from_fixed(d))
+ * gives back d, and that X_from_fixed(d) follows X_from_fixed(d - 1): the
+ * same month and the next day, or the first day of another month right
+ * after the last day of the previous one. Together those mean each date
+ * in the calendar within the range is reached exactly once, so the
+ * conversion is checked in both directions. */
+
+enum VerifyCalendar {
+    VERIFY_GREGORIAN,
+    VERIFY_JULIAN,
+    VERIFY_ISO,
+    VERIFY_ISLAMIC,
+    VERIFY_HEBREW,
+    VERIFY_MAYAN,
+    VERIFY_GREGORIAN64,             /* the int64_t functions of calendar64.h */
+    VERIFY_JULIAN64,
+    VERIFY_ISO64,
+    VERIFY_ISLAMIC64,
+    VERIFY_HEBREW64,
+    VERIFY_MAYAN64,
+    VERIFY_CHINESE,
+    VERIFY_OBSERVATIONAL_ISLAMIC,   /* at IslamicLocation */
+    VERIFY_PERSIAN,                 /* astronomical */
+    VERIFY_CALENDARS
+};
+
+struct VerifyResult {
+    long long checked;
+    bool failed;
+    int date;               /* first date that failed */
+    int fields[5];          /* what X_from_fixed gave for it, biggest unit first */
+    int round_trip;         /* what fixed_from_X made of those */
+    const char *reason;
+    double from_fixed_rate; /* conversions per second, per thread */
+    double to_fixed_rate;
+};
+
+const char *verify_calendar_name(enum VerifyCalendar cal);
+
+/* Check dates from through to, using the given number of threads
+   (0 for one per processor). Returns true if everything checked out. */
+bool verify_round_trip(enum VerifyCalendar cal, int from, int to, int threads,
+                       struct VerifyResult *result);
+
+#endif
@@ -0,0 +1,176 @@
+/*
+ *  week.c
+ *  ISO weeks and retail fiscal years for many dates at once.
+ */
+
+#ifndef CALENDRICAL_INLINE
+#define CALENDRICAL_INLINE
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include "week.h"
+
+#define EPOCH_UNIXTIME 719163
+#define BLOCK 256
+
+#pragma mark ISO
+
+/* The Thursday of a date's ISO week is in the ISO year, and its week is
+   the week of the Gregorian year that Thursday is in. The date is moved
+   on by whole 400-year cycles (which are whole weeks too) so that all the
+   divisions are of unsigned numbers by constants, which compile to
+   multiplications, and gregorian_year_from_fixed's steps are done here
+   without its branches. */
+#define CYCLES 16000ULL
+
+static inline void iso_week(int date, int *year, int *week, int *day)
+{
+    unsigned long long shifted = (unsigned long long)((long long)date + 146097 * CYCLES);
+    int d = (int)((shifted - 1) % 7) + 1;       /* fixed date 1 is a Monday */
+    unsigned long long t = shifted - d + 3;     /* the Thursday, less 1 */
+    unsigned long long n400 = t / 146097, d1 = t % 146097;
+    unsigned long long n100 = d1 / 36524, d2 = d1 % 36524;
+    unsigned long long n4 = d2 / 1461, d3 = d2 % 1461;
+    unsigned long long n1 = d3 / 365;
+    unsigned long long y = 400 * n400 + 100 * n100 + 4 * n4 + n1 + (n100 != 4 && n1 != 4);
+    unsigned long long y1 = y - 1;
+    unsigned long long before = 365 * y1 + y1 / 4 - y1 / 100 + y1 / 400;   /* December 31 */
+    *year = (int)((long long)y - 400 * (long long)CYCLES);
+    *week = (int)((t - before) / 7) + 1;
+    *day = d;
+}
+
+/* In blocks, so the loop writes every output and stays branch-free;
+   each block is then copied to the outputs that were asked for. */
+static void iso_block(const int *restrict dates, size_t n, int offset,
+                      int *restrict years, int *restrict weeks, int *restrict days)
+{
+    int y[BLOCK], w[BLOCK], d[BLOCK];
+    for (size_t base = 0; base < n; base += BLOCK) {
+        size_t m = n - base < BLOCK ? n - base : BLOCK;
+        for (size_t i = 0; i < m; i++)
+            iso_week(dates[base + i] + offset, &y[i], &w[i], &d[i]);
+        if (years) memcpy(years + base, y, m * sizeof(int));
+        if (weeks) memcpy(weeks + base, w, m * sizeof(int));
+        if (days) memcpy(days + base, d, m * sizeof(int));
+    }
+}
+
+void iso_from_fixed_n(const int *restrict dates, size_t n,
+                      int *restrict years, int *restrict weeks, int *restrict days)
+{
+    iso_block(dates, n, 0, years, weeks, days);
+}
+
+void iso_from_unix_day_n(const int *restrict days, size_t n,
+                         int *restrict years, int *restrict weeks, int *restrict iso_days)
+{
+    iso_block(days, n, EPOCH_UNIXTIME, years, weeks, iso_days);
+}
+
+#pragma mark Fiscal
+
+int fiscal_year_end(struct FiscalRules rules, int year)
+{
+    if (rules.end == FISCAL_LAST_KDAY)
+        return nth_kday_in_month(-1, rules.weekday, year, rules.month);
+    int last = last_day_of_gregorian_month(rules.month, year);
+    return kday_nearest(fixed_from_gregorian(year, rules.month, last), rules.weekday);
+}
+
+/* Week counts from 0; a 53rd week stays in the last period. */
+static int period_of_week(enum FiscalPattern pattern, int week)
+{
+    static const int first[3][2] = { { 4, 4 }, { 4, 5 }, { 5, 4 } };
+    int quarter = week / 13 < 3 ? week / 13 : 3;
+    int w = week - 13 * quarter;
+    int a = first[pattern][0], b = first[pattern][1];
+    return 3 * quarter + (w < a ? 0 : w < a + b ? 1 : 2);
+}
+
+static void fill(int year, int day_of_year, int period, struct FiscalDate *fdate)
+{
+    fdate->year = year;
+    fdate->quarter = period / 3 + 1;
+    fdate->period = period + 1;
+    fdate->week = day_of_year / 7 + 1;
+    fdate->day = day_of_year % 7 + 1;
+}
+
+void fiscal_from_fixed(struct FiscalRules rules, int date, struct FiscalDate *fdate)
+{
+    /* The year ends within a week of a month's end, so this is right or
+       one off. */
+    int year = gregorian_year_from_fixed(date);
+    int end = fiscal_year_end(rules, year);
+    int before = fiscal_year_end(rules, year - 1);
+    while (date > end) {
+        before = end;
+        end = fiscal_year_end(rules, ++year);
+    }
+    while (date <= before) {
+        end = before;
+        before = fiscal_year_end(rules, --year - 1);
+    }
+
+    int day_of_year = date - before - 1;
+    if (fdate)
+        fill(year - rules.named_for_start, day_of_year,
+             period_of_week(rules.pattern, day_of_year / 7), fdate);
+}
+
+int fixed_from_fiscal(struct FiscalRules rules, struct FiscalDate fdate)
+{
+    int year = fdate.year + rules.named_for_start;
+    return fiscal_year_end(rules, year - 1) + 7 * (fdate.week - 1) + fdate.day;
+}
+
+struct FiscalCalendar *fiscal_calendar_create(struct FiscalRules rules,
+                                              int from_year, int to_year)
+{
+    struct FiscalCalendar *calendar = malloc(sizeof(*calendar));
+    if (calendar == NULL) return NULL;
+    calendar->rules = rules;
+    calendar->first = from_year;
+    calendar->count = to_year >= from_year ? to_year - from_year + 1 : 0;
+    calendar->start = malloc((calendar->count + 1) * sizeof(int));
+    if (calendar->start == NULL) {
+        free(calendar);
+        return NULL;
+    }
+    int offset = rules.named_for_start - 1;
+    for (int i = 0; i <= calendar->count; i++)
+        calendar->start[i] = fiscal_year_end(rules, from_year + i + offset) + 1;
+    for (int week = 0; week < 53; week++)
+        calendar->period[week] = (unsigned char)period_of_week(rules.pattern, week);
+    return calendar;
+}
+
+void fiscal_calendar_destroy(struct FiscalCalendar *calendar)
+{
+    if (calendar == NULL) return;
+    free(calendar->start);
+    free(calendar);
+}
+
+void fiscal_from_fixed_n(const struct FiscalCalendar *calendar, const int *restrict dates,
+                         size_t n, struct FiscalDate *restrict fdates)
+{
+    const int *start = calendar->start;
+    int count = calendar->count;
+    for (size_t i = 0; i < n; i++) {
+        int date = dates[i];
+        if (count == 0 || date < start[0] || date >= start[count]) {
+            fiscal_from_fixed(calendar->rules, date, &fdates[i]);
+            continue;
+        }
+        /* Years of 52 and 53 weeks keep within a week of the Gregorian
+           years on average, so the mean year gets within one. */
+        int k = (int)((long long)(date - start[0]) * 400 / 146097);
+        if (k >= count) k = count - 1;
+        while (start[k] > date) k--;
+        while (start[k + 1] <= date) k++;
+        int day_of_year = date - start[k];
+        fill(calendar->first + k, day_of_year, calendar->period[day_of_year / 7], &fdates[i]);
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef WEEK_H
+#define WEEK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "calendar.h"
+
+/* Calendars of whole weeks, for bucketing many dates at once: ISO weeks,
+ * and the 52-53 week fiscal years retailers use.
+ *
+ * iso_from_fixed_n gives the same results as iso_from_fixed, but finds
+ * the year from the Thursday of the date's week, which is always in it,
+ * so each date takes one year calculation and no searching: a few
+ * divisions by constants and no branches. The results go in separate
+ * arrays, any of which may be NULL. */
+
+void iso_from_fixed_n(const int *dates, size_t n, int *years, int *weeks, int *days);
+
+/* The same from days since January 1, 1970, as fixed_from_unixtime gives
+   them less 719163, the fixed date of that day. */
+void iso_from_unix_day_n(const int *days, size_t n, int *years, int *weeks, int *iso_days);
+
+/* A retail fiscal year ends on the same day of the week every year, so it
+ * has 52 weeks or, every five or six years, 53. The day is either the last
+ * of that weekday in a Gregorian month, or the one nearest the end of the
+ * month (as kday_nearest gives it), which can fall a few days into the
+ * next month.
+ *
+ * Each quarter has 13 weeks, in periods of 4, 4 and 5 weeks, or 4, 5, 4,
+ * or 5, 4, 4. A 53rd week goes on the end of the last period.
+ *
+ * A year is named for the Gregorian year of the month it ends in, or the
+ * one before if named_for_start is set, as for years ending around the
+ * end of January that are mostly in the year before. */
+
+enum FiscalPattern { FISCAL_4_4_5, FISCAL_4_5_4, FISCAL_5_4_4 };
+enum FiscalYearEnd { FISCAL_LAST_KDAY, FISCAL_NEAREST_KDAY };
+
+struct FiscalRules {
+    enum FiscalPattern pattern;
+    enum FiscalYearEnd end;
+    int month;              /* the Gregorian month the year ends in, or nearest the end of */
+    int weekday;            /* the day the year ends on; Sunday is 0 */
+    bool named_for_start;
+};
+
+struct FiscalDate {
+    int year;
+    int quarter;            /* 1 to 4 */
+    int period;             /* 1 to 12 */
+    int week;               /* 1 to 53 */
+    int day;                /* 1 to 7, 1 being the day after the year's last weekday */
+};
+
+/* The last day of the fiscal year that ends in or near month rules.month
+   of Gregorian year year. */
+int fiscal_year_end(struct FiscalRules rules, int year) __attribute__((const));
+
+void fiscal_from_fixed(struct FiscalRules rules, int date, struct FiscalDate *fdate);
+/* From the year, week and day; the quarter and period are ignored. */
+int fixed_from_fiscal(struct FiscalRules rules, struct FiscalDate fdate) __attribute__((const));
+
+/* The first days of a range of fiscal years, and the period of each week,
+ * worked out once, so that converting a date in the range is an estimate
+ * of its year, a step or none, and a lookup. */
+
+struct FiscalCalendar {
+    struct FiscalRules rules;
+    int first;                      /* fiscal year (as named) of start[0] */
+    int count;                      /* fiscal years covered */
+    int *start;                     /* count + 1 first days, the last ending the range */
+    unsigned char period[53];       /* period of each week, from 0 */
+};
+
+/* Fiscal years from_year through to_year, as named. Returns NULL if memory
+   can't be allocated. The year starts and periods never change after
+   this, so threads can convert dates with one calendar at once. */
+struct FiscalCalendar *fiscal_calendar_create(struct FiscalRules rules,
+                                              int from_year, int to_year);
+void fiscal_calendar_destroy(struct FiscalCalendar *calendar);
+
+/* Dates outside the range are converted as by fiscal_from_fixed. */
+void fiscal_from_fixed_n(const struct FiscalCalendar *calendar, const int *dates,
+                         size_t n, struct FiscalDate *fdates);
+
+#endif